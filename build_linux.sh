@@ -1 +1 @@
-gcc -O2 -D__USE_LARGEFILE -D__USE_FILE_OFFSET64 -I. -Icompat -owd *.c wavdiff/help.c wavdiff/output.c wavdiff/wd.c -lm
\ No newline at end of file
+gcc -O2 -D__USE_LARGEFILE -D__USE_FILE_OFFSET64 -I. -Icompat -owd *.c wavdiff/editlist.c wavdiff/glitch.c wavdiff/help.c wavdiff/histogram.c wavdiff/output.c wavdiff/statcache.c wavdiff/wd.c -lm -lpthread
\ No newline at end of file
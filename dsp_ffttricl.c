@@ -40,6 +40,9 @@
  * SUCH DAMAGE.
  */
 
+// Compiled once per precision, through dsp_ffttricl_f.c and dsp_ffttricl_d.c
+#ifdef TRICL_INSTANCE
+
 #include "dsp_ffttricl.h"
 #include <math.h>
 #include <assert.h>
@@ -48,6 +51,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifndef TRICL_NO_THREADS
+#include "sys_thread.h"
+#endif
+
 #define UNUSED(x) (void)(x)
 
 /**T
@@ -765,7 +772,7 @@ sum and difference of highly composite numbers}, Math. Comp.
 \end{thebibliography}
 */
 
-void mulr2(real *a,real *b)
+static void mulr2(real *a,real *b)
 {
   register real t1, t2;
 
@@ -775,24 +782,6 @@ void mulr2(real *a,real *b)
   a[1] = t2;
 }
 
-void mulr4(real *a,real *b)
-{
-  register real t1, t2, t3, t4, t5, t6;
-
-  t1 = a[2] * b[2];
-  t2 = a[3] * b[3];
-  t3 = a[3] * b[2];
-  t4 = a[2] * b[3];
-  t5 = a[0] * b[0];
-  t6 = a[1] * b[1];
-  t1 -= t2;
-  t3 += t4;
-  a[0] = t5;
-  a[1] = t6;
-  a[2] = t1;
-  a[3] = t3;
-}
-
 
 void tricl_fftconv_mulpr_conj(real * __restrict DAT1, real * __restrict DAT2, int n)
 {
@@ -907,6 +896,99 @@ void tricl_fft_makelut(real * LUT, int n)
     }
 }
 
+/**T
+\subsection{Shared lookup tables}
+A table, made for length $2^n$, serves all shorter FFTs. The registry keeps
+one table per $n$, with a reference count: {\em tricl\_fft\_lut\_acquire}
+returns the smallest table which is large enough. Unreferenced tables are
+kept for the next user, and freed when a larger table is made, or by
+{\em tricl\_fft\_lut\_purge}. The registry is guarded by THREAD\_lock().
+*/
+
+#ifdef TRICL_NO_THREADS
+#define THREAD_lock()
+#define THREAD_unlock()
+#endif
+
+#define LUT_POOL_SIZE 30
+
+static struct
+{
+    real *                  lut;
+    int                     refs;
+} g_lut_pool[LUT_POOL_SIZE];
+
+const real * tricl_fft_lut_acquire(int n)
+{
+    real * lut;
+    int k;
+
+    assert(0 <= n && n < LUT_POOL_SIZE);
+    THREAD_lock();
+    for (k = n; k < LUT_POOL_SIZE && !g_lut_pool[k].lut; k++) {/*no action*/}
+    if (k < LUT_POOL_SIZE)
+    {
+        lut = g_lut_pool[k].lut;
+        g_lut_pool[k].refs++;
+    }
+    else
+    {
+        lut = malloc(sizeof(real) << n);
+        if (lut)
+        {
+            tricl_fft_makelut(lut, n);
+            g_lut_pool[n].lut = lut;
+            g_lut_pool[n].refs = 1;
+            // Unreferenced smaller tables are superseded
+            for (k = 0; k < n; k++)
+            {
+                if (g_lut_pool[k].lut && !g_lut_pool[k].refs)
+                {
+                    free(g_lut_pool[k].lut);
+                    g_lut_pool[k].lut = NULL;
+                }
+            }
+        }
+    }
+    THREAD_unlock();
+    return lut;
+}
+
+void tricl_fft_lut_release(const real * lut)
+{
+    int k, larger = 0;
+    THREAD_lock();
+    for (k = LUT_POOL_SIZE - 1; k >= 0; k--)
+    {
+        if (g_lut_pool[k].lut == lut && lut)
+        {
+            if (g_lut_pool[k].refs && !--g_lut_pool[k].refs && larger)
+            {
+                free(g_lut_pool[k].lut);
+                g_lut_pool[k].lut = NULL;
+            }
+            break;
+        }
+        larger |= g_lut_pool[k].lut != NULL;
+    }
+    THREAD_unlock();
+}
+
+void tricl_fft_lut_purge(void)
+{
+    int k;
+    THREAD_lock();
+    for (k = 0; k < LUT_POOL_SIZE; k++)
+    {
+        if (g_lut_pool[k].lut && !g_lut_pool[k].refs)
+        {
+            free(g_lut_pool[k].lut);
+            g_lut_pool[k].lut = NULL;
+        }
+    }
+    THREAD_unlock();
+}
+
 /**T
 \section{The FFT}
 We use a recursive ``exponent -1'' split-radix decimation-in-frequency FFT,
@@ -1154,6 +1236,258 @@ static void fft_4(real * __restrict DAT,
     FFT_PM(DAT, DAT + 2);
 }
 
+/**T
+\subsection{Vectorized butterflies}
+The $FFT\_SRM\_W$ and $IFFT\_SRM\_W$ loops of large transforms do most of
+the work. They are vectorized over consecutive elements, without changes
+of the data layout, for SSE2, AVX2+FMA and AVX-512; the widest instruction
+set, supported by the CPU, is selected at the first call of transform
+functions, or by {\em tricl\_fft\_set\_isa}.
+*/
+
+static void fft_srm_w_c(real * DAT, const real * LUT, unsigned len, unsigned from, unsigned to)
+{
+    unsigned i;
+    for (i = 2 * from; i < 2 * to; i += 2)
+        FFT_SRM_W(DAT + i, DAT + len * 2 + i,
+            DAT + len * 4 + i, DAT + len * 6 + i,
+            LUT + len * 2 + i);
+}
+
+static void ifft_srm_w_c(real * DAT, const real * LUT, unsigned len, unsigned from, unsigned to)
+{
+    unsigned i;
+    for (i = 2 * from; i < 2 * to; i += 2)
+        IFFT_SRM_W(DAT + i, DAT + len * 2 + i,
+            DAT + len * 4 + i, DAT + len * 6 + i,
+            LUT + len * 2 + i);
+}
+
+#if !defined TRICL_NO_SIMD && \
+    (defined __x86_64__ || defined __i386__ || defined _M_X64 || defined _M_IX86) && \
+    (defined __GNUC__ || (defined _MSC_VER && _MSC_VER >= 1910))
+#define TRICL_SIMD
+
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET(isa)
+#else
+#define TARGET(isa) __attribute__((target(isa)))
+#endif
+
+#if SIZEOF_REAL == 4
+// SSE2: 2 complex per vector
+#define V_NAME(x)           x ## _sse2
+#define V_TARGET            TARGET("sse2")
+#define V_CPX               2
+#define V_REG               __m128
+#define V_LOAD(p)           _mm_loadu_ps(p)
+#define V_STORE(p, x)       _mm_storeu_ps(p, x)
+#define V_ADD(x, y)         _mm_add_ps(x, y)
+#define V_SUB(x, y)         _mm_sub_ps(x, y)
+#define V_SWAP(x)           _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1))
+#define V_DUPRE(x)          _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 2, 0, 0))
+#define V_DUPIM(x)          _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 1, 1))
+#define V_ADDSUB(x, y)      _mm_add_ps(x, _mm_xor_ps(y, _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f)))
+#define V_SUBADD(x, y)      _mm_add_ps(x, _mm_xor_ps(y, _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f)))
+#define V_CMUL(x, re, im)   V_ADDSUB(_mm_mul_ps(x, re), _mm_mul_ps(V_SWAP(x), im))
+#define V_CMULJ(x, re, im)  V_SUBADD(_mm_mul_ps(x, re), _mm_mul_ps(V_SWAP(x), im))
+#include "dsp_ffttricl_simd.h"
+
+// AVX2+FMA: 4 complex per vector
+#define V_NAME(x)           x ## _avx2
+#define V_TARGET            TARGET("avx2,fma")
+#define V_CPX               4
+#define V_REG               __m256
+#define V_LOAD(p)           _mm256_loadu_ps(p)
+#define V_STORE(p, x)       _mm256_storeu_ps(p, x)
+#define V_ADD(x, y)         _mm256_add_ps(x, y)
+#define V_SUB(x, y)         _mm256_sub_ps(x, y)
+#define V_SWAP(x)           _mm256_permute_ps(x, 0xB1)
+#define V_DUPRE(x)          _mm256_moveldup_ps(x)
+#define V_DUPIM(x)          _mm256_movehdup_ps(x)
+#define V_ADDSUB(x, y)      _mm256_addsub_ps(x, y)
+#define V_SUBADD(x, y)      _mm256_fmsubadd_ps(_mm256_set1_ps(1.0f), x, y)
+#define V_CMUL(x, re, im)   _mm256_fmaddsub_ps(x, re, _mm256_mul_ps(V_SWAP(x), im))
+#define V_CMULJ(x, re, im)  _mm256_fmsubadd_ps(x, re, _mm256_mul_ps(V_SWAP(x), im))
+#include "dsp_ffttricl_simd.h"
+
+// AVX-512: 8 complex per vector
+#define V_NAME(x)           x ## _avx512
+#define V_TARGET            TARGET("avx512f")
+#define V_CPX               8
+#define V_REG               __m512
+#define V_LOAD(p)           _mm512_loadu_ps(p)
+#define V_STORE(p, x)       _mm512_storeu_ps(p, x)
+#define V_ADD(x, y)         _mm512_add_ps(x, y)
+#define V_SUB(x, y)         _mm512_sub_ps(x, y)
+#define V_SWAP(x)           _mm512_permute_ps(x, 0xB1)
+#define V_DUPRE(x)          _mm512_moveldup_ps(x)
+#define V_DUPIM(x)          _mm512_movehdup_ps(x)
+#define V_ADDSUB(x, y)      _mm512_fmaddsub_ps(_mm512_set1_ps(1.0f), x, y)
+#define V_SUBADD(x, y)      _mm512_fmsubadd_ps(_mm512_set1_ps(1.0f), x, y)
+#define V_CMUL(x, re, im)   _mm512_fmaddsub_ps(x, re, _mm512_mul_ps(V_SWAP(x), im))
+#define V_CMULJ(x, re, im)  _mm512_fmsubadd_ps(x, re, _mm512_mul_ps(V_SWAP(x), im))
+#include "dsp_ffttricl_simd.h"
+
+#else
+// SSE2: 1 complex per vector
+#define V_NAME(x)           x ## _sse2
+#define V_TARGET            TARGET("sse2")
+#define V_CPX               1
+#define V_REG               __m128d
+#define V_LOAD(p)           _mm_loadu_pd(p)
+#define V_STORE(p, x)       _mm_storeu_pd(p, x)
+#define V_ADD(x, y)         _mm_add_pd(x, y)
+#define V_SUB(x, y)         _mm_sub_pd(x, y)
+#define V_SWAP(x)           _mm_shuffle_pd(x, x, 1)
+#define V_DUPRE(x)          _mm_unpacklo_pd(x, x)
+#define V_DUPIM(x)          _mm_unpackhi_pd(x, x)
+#define V_ADDSUB(x, y)      _mm_add_pd(x, _mm_xor_pd(y, _mm_set_pd(0.0, -0.0)))
+#define V_SUBADD(x, y)      _mm_add_pd(x, _mm_xor_pd(y, _mm_set_pd(-0.0, 0.0)))
+#define V_CMUL(x, re, im)   V_ADDSUB(_mm_mul_pd(x, re), _mm_mul_pd(V_SWAP(x), im))
+#define V_CMULJ(x, re, im)  V_SUBADD(_mm_mul_pd(x, re), _mm_mul_pd(V_SWAP(x), im))
+#include "dsp_ffttricl_simd.h"
+
+// AVX2+FMA: 2 complex per vector
+#define V_NAME(x)           x ## _avx2
+#define V_TARGET            TARGET("avx2,fma")
+#define V_CPX               2
+#define V_REG               __m256d
+#define V_LOAD(p)           _mm256_loadu_pd(p)
+#define V_STORE(p, x)       _mm256_storeu_pd(p, x)
+#define V_ADD(x, y)         _mm256_add_pd(x, y)
+#define V_SUB(x, y)         _mm256_sub_pd(x, y)
+#define V_SWAP(x)           _mm256_permute_pd(x, 0x5)
+#define V_DUPRE(x)          _mm256_movedup_pd(x)
+#define V_DUPIM(x)          _mm256_permute_pd(x, 0xF)
+#define V_ADDSUB(x, y)      _mm256_addsub_pd(x, y)
+#define V_SUBADD(x, y)      _mm256_fmsubadd_pd(_mm256_set1_pd(1.0), x, y)
+#define V_CMUL(x, re, im)   _mm256_fmaddsub_pd(x, re, _mm256_mul_pd(V_SWAP(x), im))
+#define V_CMULJ(x, re, im)  _mm256_fmsubadd_pd(x, re, _mm256_mul_pd(V_SWAP(x), im))
+#include "dsp_ffttricl_simd.h"
+
+// AVX-512: 4 complex per vector
+#define V_NAME(x)           x ## _avx512
+#define V_TARGET            TARGET("avx512f")
+#define V_CPX               4
+#define V_REG               __m512d
+#define V_LOAD(p)           _mm512_loadu_pd(p)
+#define V_STORE(p, x)       _mm512_storeu_pd(p, x)
+#define V_ADD(x, y)         _mm512_add_pd(x, y)
+#define V_SUB(x, y)         _mm512_sub_pd(x, y)
+#define V_SWAP(x)           _mm512_permute_pd(x, 0x55)
+#define V_DUPRE(x)          _mm512_movedup_pd(x)
+#define V_DUPIM(x)          _mm512_permute_pd(x, 0xFF)
+#define V_ADDSUB(x, y)      _mm512_fmaddsub_pd(_mm512_set1_pd(1.0), x, y)
+#define V_SUBADD(x, y)      _mm512_fmsubadd_pd(_mm512_set1_pd(1.0), x, y)
+#define V_CMUL(x, re, im)   _mm512_fmaddsub_pd(x, re, _mm512_mul_pd(V_SWAP(x), im))
+#define V_CMULJ(x, re, im)  _mm512_fmsubadd_pd(x, re, _mm512_mul_pd(V_SWAP(x), im))
+#include "dsp_ffttricl_simd.h"
+#endif
+
+/**
+*   @return widest instruction set, supported by the CPU and the OS
+*/
+static int cpu_isa(void)
+{
+#ifdef _MSC_VER
+    int r[4];
+    unsigned long long xcr0 = 0;
+    int avx2 = 0, fma, avx512 = 0;
+
+    __cpuid(r, 0);
+    if (r[0] < 1)
+    {
+        return TRICL_ISA_C;
+    }
+    __cpuid(r, 1);
+    fma = (r[2] >> 12) & 1;
+    if (!((r[3] >> 26) & 1))
+    {
+        return TRICL_ISA_C;
+    }
+    if ((r[2] >> 27) & 1)
+    {
+        xcr0 = _xgetbv(0);                      // OSXSAVE: the OS saves YMM/ZMM state
+    }
+    __cpuid(r, 0);
+    if (r[0] >= 7)
+    {
+        __cpuidex(r, 7, 0);
+        avx2 = (r[1] >> 5) & 1;
+        avx512 = (r[1] >> 16) & 1;
+    }
+    if (avx512 && (xcr0 & 0xE6) == 0xE6)
+    {
+        return TRICL_ISA_AVX512;
+    }
+    if (avx2 && fma && (xcr0 & 6) == 6)
+    {
+        return TRICL_ISA_AVX2;
+    }
+    return TRICL_ISA_SSE2;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return TRICL_ISA_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        return TRICL_ISA_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return TRICL_ISA_SSE2;
+    }
+    return TRICL_ISA_C;
+#endif
+}
+
+#endif //TRICL_SIMD
+
+static void (* g_fft_srm_w)(real *, const real *, unsigned, unsigned, unsigned) = fft_srm_w_c;
+static void (* g_ifft_srm_w)(real *, const real *, unsigned, unsigned, unsigned) = ifft_srm_w_c;
+static int g_isa = -1;
+
+int tricl_fft_set_isa(int isa)
+{
+    void (* fft)(real *, const real *, unsigned, unsigned, unsigned) = fft_srm_w_c;
+    void (* ifft)(real *, const real *, unsigned, unsigned, unsigned) = ifft_srm_w_c;
+#ifdef TRICL_SIMD
+    int cpu = cpu_isa();
+    if (isa > cpu)
+    {
+        isa = cpu;
+    }
+    switch (isa)
+    {
+    case TRICL_ISA_AVX512:
+        fft = fft_srm_w_avx512;
+        ifft = ifft_srm_w_avx512;
+        break;
+    case TRICL_ISA_AVX2:
+        fft = fft_srm_w_avx2;
+        ifft = ifft_srm_w_avx2;
+        break;
+    case TRICL_ISA_SSE2:
+        fft = fft_srm_w_sse2;
+        ifft = ifft_srm_w_sse2;
+        break;
+    default:
+        isa = TRICL_ISA_C;
+    }
+#else
+    isa = TRICL_ISA_C;
+#endif
+    g_fft_srm_w = fft;
+    g_ifft_srm_w = ifft;
+    g_isa = isa;
+    return isa;
+}
+
 /**T
 \subsection{Large FFTs}
 For lengths $2^5$ up to $2^{29}$, we define a generic split-radix FFT macro
@@ -1173,13 +1507,8 @@ code size which would result.
 static void fft_ ## n(real * __restrict DAT,              \
     const real * __restrict LUT)                        \
 {                                   \
-    unsigned i;                         \
-                                    \
     FFT_SRM(DAT, DAT + len * 2, DAT + len * 4, DAT + len * 6);  \
-    for (i = 2; i < 2 * len; i += 2)                \
-        FFT_SRM_W(DAT + i, DAT + len * 2 + i,           \
-            DAT + len * 4 + i, DAT + len * 6 + i,       \
-            LUT + len * 2 + i);                 \
+    g_fft_srm_w(DAT, LUT, len, 1, len);             \
                                     \
     fft_ ## nm2(DAT + len * 4, LUT);                \
     fft_ ## nm2(DAT + len * 6, LUT);                \
@@ -1256,17 +1585,12 @@ $2^5$ up to $2^{29}$.
 static void ifft_ ## n(real * __restrict DAT,             \
     const real * __restrict LUT)                        \
 {                                   \
-    unsigned i;                         \
-                                    \
     ifft_ ## nm1(DAT, LUT);                     \
     ifft_ ## nm2(DAT + len * 4, LUT);               \
     ifft_ ## nm2(DAT + len * 6, LUT);               \
                                     \
     IFFT_SRM(DAT, DAT + len * 2, DAT + len * 4, DAT + len * 6); \
-    for (i = 2; i < 2 * len; i += 2)                \
-        IFFT_SRM_W(DAT + i, DAT + len * 2 + i,          \
-            DAT + len * 4 + i, DAT + len * 6 + i,       \
-            LUT + len * 2 + i);                 \
+    g_ifft_srm_w(DAT, LUT, len, 1, len);            \
 }
 
 /**T
@@ -1377,7 +1701,7 @@ static void r2c_0(__unused real * __restrict DAT, __unused const real * __restri
     /* Do nothing */
 }
 
-void r2c_1(real * __restrict a, __unused const real * __restrict w)
+static void r2c_1(real * __restrict a, __unused const real * __restrict w)
 {
   register real t1, t2;
 
@@ -1389,7 +1713,7 @@ void r2c_1(real * __restrict a, __unused const real * __restrict w)
   a[1] = t2;
 }
 
-void r2c_2(real * __restrict a, __unused const real * __restrict w)
+static void r2c_2(real * __restrict a, __unused const real * __restrict w)
 {
   register real t1, t2, t3, t4, t6;
 
@@ -1407,7 +1731,7 @@ void r2c_2(real * __restrict a, __unused const real * __restrict w)
   a[1] = t6;
 }
 
-void r2c_3(real * __restrict a, __unused const real * __restrict w)
+static void r2c_3(real * __restrict a, __unused const real * __restrict w)
 {
   register double t1, t2, t3, t4, t5, t6, t7, t8;
 
@@ -1447,7 +1771,7 @@ void r2c_3(real * __restrict a, __unused const real * __restrict w)
 
 
 
-void r2c_4(real * __restrict a, const real * __restrict w)
+static void r2c_4(real * __restrict a, const real * __restrict w)
 {
   register real t1, t2, t3, t4, t5, t6;
 
@@ -1460,7 +1784,7 @@ void r2c_4(real * __restrict a, const real * __restrict w)
 }
 
 /* a[0...8n-1], w[0...2n-1]; n even, n >= 4 */
-void rpass(register real *a,register const real *w,register unsigned int n)
+static void rpass(register real *a,register const real *w,register unsigned int n)
 {
   register real t1, t2, t3, t4, t5, t6;
   register real *b;
@@ -1504,7 +1828,7 @@ static void c2r_0(__unused real * __restrict DAT, __unused const real * __restri
     UNUSED(w);
     /* Do nothing */
 }
-void c2r_1(real * __restrict a, __unused const real * __restrict w)
+static void c2r_1(real * __restrict a, __unused const real * __restrict w)
 {
   register real t1, t2;
   
@@ -1515,7 +1839,7 @@ void c2r_1(real * __restrict a, __unused const real * __restrict w)
   a[0] = t1;
   a[1] = t2;
 }
-void c2r_2(real * __restrict a, __unused const real * __restrict w)
+static void c2r_2(real * __restrict a, __unused const real * __restrict w)
 {
   register real t1, t3, t5, t6;
 
@@ -1532,7 +1856,7 @@ void c2r_2(real * __restrict a, __unused const real * __restrict w)
   a[2] = t3;
   a[3] = t6;
 }
-void c2r_3(real * __restrict a, __unused const real * __restrict w)
+static void c2r_3(real * __restrict a, __unused const real * __restrict w)
 {
   register double t1, t2, t3, t4, t5, t6, t7, t8;
   
@@ -1570,7 +1894,7 @@ void c2r_3(real * __restrict a, __unused const real * __restrict w)
   a[6] = (real)t6;
 }
 /* a[0...8n-1], w[0...2n-1]; n even, n >= 4 */
-void vpass(register real *a,register const real *w,register unsigned int n)
+static void vpass(register real *a,register const real *w,register unsigned int n)
 {
   register real t1, t2, t3, t4, t5, t6;
   register real *b;
@@ -1595,7 +1919,7 @@ void vpass(register real *a,register const real *w,register unsigned int n)
     w += 4*2;
   }
 }
-void c2r_4(real * __restrict a, __unused const real * __restrict w)
+static void c2r_4(real * __restrict a, __unused const real * __restrict w)
 {
   register real t1, t2, t3, t4, t5, t6;
 
@@ -1642,17 +1966,26 @@ X(27, 26, 25, 33554432)
 //X(28, 27, 26, 67108864) 
 //X(29, 28, 27, 134217728)
 
-#define DEFINE_API(X) \
+#define DEFINE_LIST(X) \
 static void (* X ## _list[])(real * __restrict, const real * __restrict) = {        \
     X ## _0, X ## _1, X ## _2,  X ## _3,  X ## _4,  X ## _5,  X ## _6,  X ## _7,    \
     X ## _8, X ## _9, X ## _10, X ## _11, X ## _12, X ## _13, X ## _14, X ## _15,   \
     X ## _16, X ## _17, X ## _18, X ## _19, X ## _20, X ## _21, X ## _22, X ## _23, \
     X ## _24, X ## _25, X ## _26, X ## _27                                          \
-};                                                                                  \
+};
+
+#define DEFINE_API(X) \
 void tricl_fft_ ## X(real * __restrict DAT, int size, const real * __restrict LUT)  \
 {                                                                                   \
     assert(0 <= size && size <= (int)(sizeof(X ## _list) / sizeof(X ## _list[0]))); \
-    X ## _list[size](DAT, LUT);                                                     \
+    if (g_isa < 0)                                                                  \
+    {                                                                               \
+        tricl_fft_set_isa(TRICL_ISA_MAX);                                           \
+    }                                                                               \
+    if (!par_transform(PAR_ ## X, DAT, size, LUT))                                  \
+    {                                                                               \
+        X ## _list[size](DAT, LUT);                                                 \
+    }                                                                               \
 }
 
 DEFINE_FUNCS(FFT_FUNC)
@@ -1665,6 +1998,363 @@ DEFINE_FUNCS(C2RFFT_FUNC)
 #pragma warning (disable: 6385) 
 #endif
 
+DEFINE_LIST(fft)
+DEFINE_LIST(ifft)
+DEFINE_LIST(c2r)
+DEFINE_LIST(r2c)
+
+/**T
+\subsection{Parallel transforms}
+Large transforms stream the whole array through memory at each of the top
+recursion levels. These levels are done level by level, each split by
+elements over threads; the sub-transforms below them fit in cache and are
+done by threads independently. Results and output order are the same as
+of a single thread.
+*/
+
+#define PAR_MIN_LOG         18                  // Min transform size for threads, log2(reals)
+#define PAR_LEAF_LOG        15                  // Max sub-transform size for one thread, log2(reals)
+#define PAR_THREADS_MAX     64
+#define PAR_ALIGN           8                   // Split points, elements: multiple of vector widths
+
+enum { PAR_fft, PAR_ifft, PAR_r2c, PAR_c2r };
+
+static unsigned g_threads = 0;
+
+void tricl_fft_set_threads(unsigned threads)
+{
+    g_threads = threads;
+}
+
+#ifndef TRICL_NO_THREADS
+
+/**
+*   Recursion node: a top level pass, or a sub-transform, done by one thread
+*/
+typedef struct
+{
+    real *                  dat;
+    unsigned char           kind;               //!< PAR_*
+    unsigned char           log2n;              //!< Size argument of transform function
+    unsigned char           depth;              //!< Recursion level
+} par_node_t;
+
+/**
+*   Thread job: slice of passes of one level, or of sub-transforms
+*/
+typedef struct
+{
+    const par_node_t *      node;
+    size_t                  count;
+    const real *            lut;
+    size_t                  from;               //!< Passes: elements of all passes; sub-transforms: nodes
+    size_t                  to;
+} par_job_t;
+
+
+static int par_log_reals(int kind, int log2n)
+{
+    return kind == PAR_fft || kind == PAR_ifft ? log2n + 1 : log2n;
+}
+
+
+/**
+*   Split transform recursion into top level passes and sub-transforms.
+*   Nodes are counted only, if arrays are NULL.
+*/
+static void par_split(par_node_t * pass, size_t * npass, par_node_t * leaf, size_t * nleaf,
+                      int kind, real * dat, int log2n, int depth)
+{
+    par_node_t node;
+    size_t half = (size_t)1 << (log2n - 1);
+    node.dat = dat;
+    node.kind = (unsigned char)kind;
+    node.log2n = (unsigned char)log2n;
+    node.depth = (unsigned char)depth;
+    if (par_log_reals(kind, log2n) <= PAR_LEAF_LOG)
+    {
+        if (leaf)
+        {
+            leaf[*nleaf] = node;
+        }
+        (*nleaf)++;
+        return;
+    }
+    if (pass)
+    {
+        pass[*npass] = node;
+    }
+    (*npass)++;
+
+    // Same recursion as FFT_FUNC, IFFT_FUNC, R2CFFT_FUNC, C2RFFT_FUNC
+    switch (kind)
+    {
+    case PAR_fft:
+    case PAR_ifft:
+        par_split(pass, npass, leaf, nleaf, kind, dat + half * 2, log2n - 2, depth + 1);
+        par_split(pass, npass, leaf, nleaf, kind, dat + half * 3, log2n - 2, depth + 1);
+        par_split(pass, npass, leaf, nleaf, kind, dat, log2n - 1, depth + 1);
+        break;
+    case PAR_r2c:
+        par_split(pass, npass, leaf, nleaf, PAR_r2c, dat, log2n - 1, depth + 1);
+        par_split(pass, npass, leaf, nleaf, PAR_fft, dat + half, log2n - 2, depth + 1);
+        break;
+    case PAR_c2r:
+        par_split(pass, npass, leaf, nleaf, PAR_ifft, dat + half, log2n - 2, depth + 1);
+        par_split(pass, npass, leaf, nleaf, PAR_c2r, dat, log2n - 1, depth + 1);
+        break;
+    }
+}
+
+
+/**
+*   rpass() and vpass() over elements from..to-1
+*/
+static void rpass_range(real * a, const real * w, unsigned n, unsigned from, unsigned to)
+{
+    real t1, t2, t3, t4, t5, t6;
+    real * b = a + 4 * n;
+    unsigned j;
+    if (!from)
+    {
+        RZERO(a[0],a[1],b[0],b[1]);
+        from = 1;
+    }
+    for (j = from; j < to; j++)
+    {
+        R(a[2*j],a[2*j+1],b[2*j],b[2*j+1],w[2*j-2],w[2*j-1]);
+    }
+}
+
+static void vpass_range(real * a, const real * w, unsigned n, unsigned from, unsigned to)
+{
+    real t1, t2, t3, t4, t5, t6;
+    real * b = a + 4 * n;
+    unsigned j;
+    if (!from)
+    {
+        VZERO(a[0],a[1],b[0],b[1]);
+        from = 1;
+    }
+    for (j = from; j < to; j++)
+    {
+        V(a[2*j],a[2*j+1],b[2*j],b[2*j+1],w[2*j-2],w[2*j-1]);
+    }
+}
+
+
+/**
+*   Top level pass of the node over elements from..to-1 of 2^(log2n-2)
+*/
+static void par_pass(const par_node_t * p, const real * lut, unsigned from, unsigned to)
+{
+    real * a = p->dat;
+    unsigned len = 1u << (p->log2n - 2);
+    switch (p->kind)
+    {
+    case PAR_fft:
+        if (!from)
+        {
+            FFT_SRM(a, a + len * 2, a + len * 4, a + len * 6);
+            from = 1;
+        }
+        g_fft_srm_w(a, lut, len, from, to);
+        break;
+    case PAR_ifft:
+        if (!from)
+        {
+            IFFT_SRM(a, a + len * 2, a + len * 4, a + len * 6);
+            from = 1;
+        }
+        g_ifft_srm_w(a, lut, len, from, to);
+        break;
+    case PAR_r2c:
+        rpass_range(a, lut + 2 + (1 << (p->log2n - 1)), len / 2, from, to);
+        break;
+    case PAR_c2r:
+        vpass_range(a, lut + 2 + (1 << (p->log2n - 1)), len / 2, from, to);
+        break;
+    }
+}
+
+
+static void par_pass_job(void * arg)
+{
+    const par_job_t * job = (const par_job_t *)arg;
+    size_t i, base = 0;
+    for (i = 0; i < job->count && base < job->to; i++)
+    {
+        size_t len = (size_t)1 << (job->node[i].log2n - 2);
+        size_t from = job->from > base ? job->from - base : 0;
+        size_t to = job->to < base + len ? job->to - base : len;
+        if (from < to)
+        {
+            par_pass(job->node + i, job->lut, (unsigned)from, (unsigned)to);
+        }
+        base += len;
+    }
+}
+
+
+static void par_leaf_job(void * arg)
+{
+    const par_job_t * job = (const par_job_t *)arg;
+    size_t i;
+    for (i = job->from; i < job->to; i++)
+    {
+        const par_node_t * p = job->node + i;
+        switch (p->kind)
+        {
+        case PAR_fft:  fft_list[p->log2n](p->dat, job->lut);  break;
+        case PAR_ifft: ifft_list[p->log2n](p->dat, job->lut); break;
+        case PAR_r2c:  r2c_list[p->log2n](p->dat, job->lut);  break;
+        case PAR_c2r:  c2r_list[p->log2n](p->dat, job->lut);  break;
+        }
+    }
+}
+
+
+/**
+*   Run jobs by threads; job of a thread, which can't be started, is done
+*   by the calling thread
+*/
+static void par_run(thread_proc_t proc, par_job_t * job, unsigned threads)
+{
+    thread_t * t[PAR_THREADS_MAX];
+    unsigned i;
+    for (i = 1; i < threads; i++)
+    {
+        t[i] = THREAD_create(proc, job + i);
+    }
+    proc(job);
+    for (i = 1; i < threads; i++)
+    {
+        if (t[i])
+        {
+            THREAD_join(t[i]);
+        }
+        else
+        {
+            proc(job + i);
+        }
+    }
+}
+
+
+/**
+*   Passes of one level: elements are split evenly
+*/
+static void par_passes(const par_node_t * node, size_t count, const real * lut, unsigned threads)
+{
+    par_job_t job[PAR_THREADS_MAX];
+    size_t total = 0, i;
+    for (i = 0; i < count; i++)
+    {
+        total += (size_t)1 << (node[i].log2n - 2);
+    }
+    for (i = 0; i < threads; i++)
+    {
+        job[i].node = node;
+        job[i].count = count;
+        job[i].lut = lut;
+        job[i].from = i ? job[i - 1].to : 0;
+        job[i].to = i + 1 < threads ? (total / threads * (i + 1)) & ~(size_t)(PAR_ALIGN - 1) : total;
+    }
+    par_run(par_pass_job, job, threads);
+}
+
+
+/**
+*   Sub-transforms: split evenly by n*log(n) cost
+*/
+static void par_leaves(const par_node_t * node, size_t count, const real * lut, unsigned threads)
+{
+    par_job_t job[PAR_THREADS_MAX];
+    double total = 0, done = 0;
+    size_t i, k = 0;
+    for (i = 0; i < count; i++)
+    {
+        total += (double)node[i].log2n * ((size_t)1 << node[i].log2n);
+    }
+    for (i = 0; i < threads; i++)
+    {
+        job[i].node = node;
+        job[i].count = count;
+        job[i].lut = lut;
+        job[i].from = k;
+        while (k < count && (i + 1 == threads ||
+               done + 0.5 * node[k].log2n * ((size_t)1 << node[k].log2n) < total * (i + 1) / threads))
+        {
+            done += (double)node[k].log2n * ((size_t)1 << node[k].log2n);
+            k++;
+        }
+        job[i].to = k;
+    }
+    par_run(par_leaf_job, job, threads);
+}
+
+
+static int par_cmp_depth(const void * a, const void * b)
+{
+    return (int)((const par_node_t *)a)->depth - (int)((const par_node_t *)b)->depth;
+}
+
+
+/**
+*   Transform by threads
+*   @return 0 if transform is small, single thread is set or no memory
+*/
+static int par_transform(int kind, real * dat, int log2n, const real * lut)
+{
+    unsigned threads = g_threads ? g_threads : THREAD_cpu_count();
+    size_t npass = 0, nleaf = 0, from, to;
+    par_node_t * pass;
+    par_node_t * leaf;
+
+    threads = threads < PAR_THREADS_MAX ? threads : PAR_THREADS_MAX;
+    if (threads < 2 || par_log_reals(kind, log2n) < PAR_MIN_LOG)
+    {
+        return 0;
+    }
+    par_split(NULL, &npass, NULL, &nleaf, kind, dat, log2n, 0);
+    pass = malloc((npass + nleaf) * sizeof(par_node_t));
+    if (!pass)
+    {
+        return 0;
+    }
+    leaf = pass + npass;
+    npass = nleaf = 0;
+    par_split(pass, &npass, leaf, &nleaf, kind, dat, log2n, 0);
+    qsort(pass, npass, sizeof(par_node_t), par_cmp_depth);
+
+    if (kind == PAR_fft || kind == PAR_r2c)
+    {
+        // Passes before sub-transforms, top level first
+        for (from = 0; from < npass; from = to)
+        {
+            for (to = from + 1; to < npass && pass[to].depth == pass[from].depth; to++) {}
+            par_passes(pass + from, to - from, lut, threads);
+        }
+        par_leaves(leaf, nleaf, lut, threads);
+    }
+    else
+    {
+        // Inverse: sub-transforms first, then passes, top level last
+        par_leaves(leaf, nleaf, lut, threads);
+        for (to = npass; to > 0; to = from)
+        {
+            for (from = to - 1; from > 0 && pass[from - 1].depth == pass[to - 1].depth; from--) {}
+            par_passes(pass + from, to - from, lut, threads);
+        }
+    }
+    free(pass);
+    return 1;
+}
+
+#else
+#define par_transform(kind, dat, log2n, lut) 0
+#endif //TRICL_NO_THREADS
+
 DEFINE_API(fft)
 DEFINE_API(ifft)
 DEFINE_API(c2r)
@@ -2023,7 +2713,7 @@ void tricl_fft2dconv_mulpw(real * __restrict DAT1, real * __restrict DAT2, int n
 typedef struct tricl_fft_real_spectr_t
 {
     int log2n;
-    real * twid;
+    const real * twid;                          // shared, see tricl_fft_lut_acquire()
     int  * perm;
     real * spec;
     real * temp;
@@ -2039,17 +2729,37 @@ tricl_fft_real_spectr_t * tricl_fft_real_spectr_mem_alloc(int n)
     tricl_fft_real_spectr_t * h;
     for (log2n = 0; (1<<log2n) < n; log2n++) {/*no action*/}
     nfft = 1<<log2n;
-    h = malloc(sizeof(tricl_fft_real_spectr_t) + (nfft * 4 + 2) * sizeof(real));
+    h = malloc(sizeof(tricl_fft_real_spectr_t) + (nfft * 3 + 2) * sizeof(real));
+    if (!h)
+    {
+        return NULL;
+    }
     h->log2n = log2n;
-    h->twid = h->_;
-    h->temp = h->twid + nfft;
+    h->twid = tricl_fft_lut_acquire(log2n);
+    if (!h->twid)
+    {
+        free(h);
+        return NULL;
+    }
+    h->temp = h->_;
     h->spec = h->temp + nfft;
     h->perm = (int*)(h->spec + nfft + 2);
     fftfreq_rtable((unsigned *)h->perm, nfft);
-    tricl_fft_makelut(h->twid, log2n);
     return h;
 }
 
+/**
+*   Free memory of spectrum analysis
+*/
+void tricl_fft_real_spectr_free(tricl_fft_real_spectr_t * h)
+{
+    if (h)
+    {
+        tricl_fft_lut_release(h->twid);
+        free(h);
+    }
+}
+
 /**
 *   Reorder complex spectrum after real-to-complex transform
 */
@@ -2183,7 +2893,7 @@ static real * tricl_fft_bluestein_chirp_ex(int n, double freq_scalefactor)
 void tricl_fft_chirpz_free(tricl_fft_chirpz_t * h)
 {
 #define FREE(x) if (x) free(x)
-    FREE(h->lut);
+    tricl_fft_lut_release(h->lut);
     FREE(h->chirp_time1);
     FREE(h->chirp_time2);
     FREE(h->chirp_freq);
@@ -2204,8 +2914,7 @@ tricl_fft_chirpz_t * tricl_fft_chirpz_alloc(int n, int m, const real a[2], const
 
         h->log2nfft = tricl_fft_bluestein_logsize(n + m-1);
         h->nfft = 1<<h->log2nfft;
-        h->lut = malloc(h->nfft * sizeof(real));
-        tricl_fft_makelut(h->lut, h->log2nfft);
+        h->lut = tricl_fft_lut_acquire(h->log2nfft);
 
         h->chirp_time1 = tricl_fft_bluestein_chirp_ex(h->ntime, freq_scalefactor);
         h->chirp_time2 = tricl_fft_bluestein_chirp_ex(h->mfreq, -freq_scalefactor);
@@ -2285,7 +2994,7 @@ struct tricl_fft_bluestein_t
     int n;      // radix-2 transform size
     int log2n;  // 
     int ntime;
-    real * lut;
+    const real * lut;
     real * chirp;
     real * chirpfreq;
     real * scratch;
@@ -2300,8 +3009,7 @@ tricl_fft_bluestein_t * tricl_fft_bluestein_alloc(int n)
         h->ntime = n;
         h->log2n = tricl_fft_bluestein_logsize(n);
         h->n = 1<<h->log2n;
-        h->lut = malloc(h->n * sizeof(real));
-        tricl_fft_makelut(h->lut, h->log2n);
+        h->lut = tricl_fft_lut_acquire(h->log2n);
         h->chirp = tricl_fft_bluestein_chirp(h->ntime, +1);
         h->chirpfreq = calloc(2*h->n, sizeof(real));
         h->chirpfreq[0] = h->chirp[0];
@@ -2320,7 +3028,7 @@ tricl_fft_bluestein_t * tricl_fft_bluestein_alloc(int n)
 
 void tricl_fft_bluestein_free(tricl_fft_bluestein_t * h)
 {
-    free(h->lut);
+    tricl_fft_lut_release(h->lut);
     free(h->chirp);
     free(h->chirpfreq);
     free(h->scratch);
@@ -2386,9 +3094,7 @@ void tricl_fft_bluestein(real * x, int xsize, int sign, real  * out)
     real * chirp = tricl_fft_bluestein_chirp(xsize, sign);
     real * xmod =  calloc(2*n,sizeof(real));
     real * h =  calloc(4*n, sizeof(real));
-    real * lut =  calloc(2*n, sizeof(real));
-
-    tricl_fft_makelut(lut, logn);
+    const real * lut = tricl_fft_lut_acquire(logn);
 
     for (i = 0; i < xsize; i++)
     {
@@ -2446,7 +3152,7 @@ void tricl_fft_bluestein(real * x, int xsize, int sign, real  * out)
     free(chirp);
     free(xmod);
     free(h);
-    free(lut);
+    tricl_fft_lut_release(lut);
 }
 
 
@@ -2457,9 +3163,7 @@ void tricl_fft_bluestein_ex(real * x, int xsize, double freq_scalefactor, real
     real * chirp = tricl_fft_bluestein_chirp_ex(xsize, freq_scalefactor);
     real * xmod =  calloc(2*n,sizeof(real));
     real * h =  calloc(4*n, sizeof(real));
-    real * lut =  calloc(2*n, sizeof(real));
-
-    tricl_fft_makelut(lut, logn);
+    const real * lut = tricl_fft_lut_acquire(logn);
 
     for (i = 0; i < xsize; i++)
     {
@@ -2504,12 +3208,576 @@ void tricl_fft_bluestein_ex(real * x, int xsize, double freq_scalefactor, real
     free(chirp);
     free(h);
     free(xmod);
-    free(lut);
+    tricl_fft_lut_release(lut);
 }
 
 
 
 
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+*   Circular cross-correlation in natural order. Shuffle of the input is
+*   done by the top level pass of tricl_fft_r2c() (rpass), and unshuffle of
+*   the output by the top level pass of tricl_fft_c2r() (vpass), which read
+*   and write natural order arrays; scale is applied with the product.
+*   Sub-transforms below the top level are the usual ones.
+*/
+#define XCORR_LOG_MIN 5                         // R2CFFT_FUNC, C2RFFT_FUNC sizes
+
+/**
+*   rpass() of 2^logn reals x, stride apart, zero-padded after nx, to
+*   shuffled layout of dst
+*/
+#define XCORR_RPASS(T)                                                      \
+static void xcorr_rpass_ ## T(real * dst, const T * x, size_t nx, size_t stride, int logn, const real * lut) \
+{                                                                           \
+    size_t n4 = (size_t)1 << (logn - 2), j;                                 \
+    const real * w = lut + 2 + (1 << (logn - 1));                           \
+    real * b = dst + 2 * n4;                                                \
+    real t1, t2, t3, t4, t5, t6;                                            \
+    for (j = 0; j < n4; j++)                                                \
+    {                                                                       \
+        real a0 = j          < nx ? (real)x[stride * j]            : 0;    \
+        real a1 = j + 2 * n4 < nx ? (real)x[stride * (j + 2 * n4)] : 0;    \
+        real b0 = j + n4     < nx ? (real)x[stride * (j + n4)]     : 0;    \
+        real b1 = j + 3 * n4 < nx ? (real)x[stride * (j + 3 * n4)] : 0;    \
+        if (j)                                                              \
+        {                                                                   \
+            R(a0, a1, b0, b1, w[2*j - 2], w[2*j - 1]);                      \
+        }                                                                   \
+        else                                                                \
+        {                                                                   \
+            RZERO(a0, a1, b0, b1);                                          \
+        }                                                                   \
+        dst[2*j] = a0;                                                      \
+        dst[2*j + 1] = a1;                                                  \
+        b[2*j] = b0;                                                        \
+        b[2*j + 1] = b1;                                                    \
+    }                                                                       \
+}
+
+XCORR_RPASS(real)
+XCORR_RPASS(float)
+
+/**
+*   vpass() of shuffled src to 2^logn reals of natural order out, stride
+*   apart
+*/
+static void xcorr_vpass(real * out, size_t stride, real * src, int logn, const real * lut)
+{
+    size_t n4 = (size_t)1 << (logn - 2), j;
+    const real * w = lut + 2 + (1 << (logn - 1));
+    const real * b = src + 2 * n4;
+    real t1, t2, t3, t4, t5, t6;
+    for (j = 0; j < n4; j++)
+    {
+        real a0 = src[2*j], a1 = src[2*j + 1];
+        real b0 = b[2*j], b1 = b[2*j + 1];
+        if (j)
+        {
+            V(a0, a1, b0, b1, w[2*j - 2], w[2*j - 1]);
+        }
+        else
+        {
+            VZERO(a0, a1, b0, b1);
+        }
+        out[stride * j] = a0;
+        out[stride * (j + 2 * n4)] = a1;
+        out[stride * (j + n4)] = b0;
+        out[stride * (j + 3 * n4)] = b1;
+    }
+}
+
+/**
+*   z = x * conj(y) * scale, tricl_fft_r2c() spectra; z may be x or y. DC
+*   and Nyquist are halved, as tricl_fft_r2c_scale() does
+*/
+static void xcorr_mul(real * z, const real * x, const real * y, int logn, double scale)
+{
+    size_t i;
+    z[0] = (real)(x[0] * y[0] * scale * 0.5);
+    z[1] = (real)(x[1] * y[1] * scale * 0.5);
+    for (i = 1; i < (size_t)1 << (logn - 1); i++)
+    {
+        real xr = x[2*i], xi = x[2*i + 1];
+        real yr = y[2*i], yi = y[2*i + 1];
+        z[2*i]     = (real)((xr * yr + xi * yi) * scale);
+        z[2*i + 1] = (real)((xi * yr - xr * yi) * scale);
+    }
+}
+
+#define TRICL_FFT_XCORR(NAME, T)                                            \
+void NAME(const T * x, int nx, const T * y, int ny, real * out, real * work, int logn, const real * lut) \
+{                                                                           \
+    size_t n = (size_t)1 << logn, i, k;                                     \
+    size_t half = n / 2;                                                    \
+    if (logn < XCORR_LOG_MIN)                                               \
+    {                                                                       \
+        /* Small: directly */                                               \
+        for (k = 0; k < n; k++)                                             \
+        {                                                                   \
+            double sum = 0;                                                 \
+            for (i = 0; i < (size_t)ny && i < n; i++)                       \
+            {                                                               \
+                size_t j = (i + k) & (n - 1);                               \
+                sum += j < (size_t)nx ? (double)x[j] * y[i] : 0;            \
+            }                                                               \
+            out[k] = (real)sum;                                             \
+        }                                                                   \
+        return;                                                             \
+    }                                                                       \
+    xcorr_rpass_ ## T(out, x, nx, 1, logn, lut);                            \
+    tricl_fft_r2c(out, logn - 1, lut);                                      \
+    tricl_fft_fft(out + half, logn - 2, lut);                               \
+    xcorr_rpass_ ## T(work, y, ny, 1, logn, lut);                           \
+    tricl_fft_r2c(work, logn - 1, lut);                                     \
+    tricl_fft_fft(work + half, logn - 2, lut);                              \
+    xcorr_mul(work, out, work, logn, 2.0 / n);                              \
+    tricl_fft_ifft(work + half, logn - 2, lut);                             \
+    tricl_fft_c2r(work, logn - 1, lut);                                     \
+    xcorr_vpass(out, 1, work, logn, lut);                                   \
+}
+
+TRICL_FFT_XCORR(tricl_fft_xcorr, real)
+TRICL_FFT_XCORR(tricl_fft_xcorr_float, float)
+
+#undef XCORR_RPASS
+#undef TRICL_FFT_XCORR
+
+
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+*   Mixed-radix real transforms of size n = R * 2^b, R = 1, 3, 5, 7, 9, 15,
+*   for fast convolution. Real radix-R pass splits the signal to R sequences
+*   of P = n/R samples:
+*
+*       u_k[p] = sum(x[p + P*j] * W(R)^(j*k), j = 0..R-1) * W(n)^(p*k),
+*       X[R*q + k] = FFT_P(u_k)[q],     W(n) = exp(2*pi*i/n)
+*
+*   u_0 is real, u_(R-k) is redundant to u_k; so spectrum is tricl_fft_r2c()
+*   of u_0 (P reals), followed by tricl_fft_fft() of u_1 .. u_(R-1)/2 (P
+*   complex each): n reals, in transform order. Sizes step by at most 1/6
+*   over each octave, and all work besides the radix pass is done by the
+*   vectorized and threaded power of 2 transforms above.
+*/
+#define MIXED_RADIX_MAX 15
+#define MIXED_SIZE_LOG_MIN 2
+
+static const int g_mixed_radix[] = {1, 3, 5, 7, 9, 15};
+
+struct tricl_fft_mixed_t
+{
+    int n;                                      // transform size, reals
+    int radix;                                  // R
+    int log2p;                                  // log2 of P = n/R
+    const real * lut;                           // shared, see tricl_fft_lut_acquire()
+    real * twid;                                // W(n)^p, p < P
+    double cs[MIXED_RADIX_MAX/2 + 1][MIXED_RADIX_MAX/2 + 1][2];   // cos, sin of 2*pi*j*k/R
+};
+
+int tricl_fft_mixed_size(int n)
+{
+    int i, best = 0;
+    for (i = 0; i < (int)(sizeof(g_mixed_radix) / sizeof(g_mixed_radix[0])); i++)
+    {
+        int size = g_mixed_radix[i] << MIXED_SIZE_LOG_MIN;
+        while (size < n && size <= 0x3fffffff)
+        {
+            size *= 2;
+        }
+        if (size >= n && (!best || size < best))
+        {
+            best = size;
+        }
+    }
+    return best;
+}
+
+tricl_fft_mixed_t * tricl_fft_mixed_alloc(int n)
+{
+    tricl_fft_mixed_t * h;
+    int j, k, p;
+
+    if (n < 1 || tricl_fft_mixed_size(n) != n)
+    {
+        return NULL;
+    }
+    h = calloc(1, sizeof(tricl_fft_mixed_t));
+    if (!h)
+    {
+        return NULL;
+    }
+    h->n = n;
+    for (h->radix = n; !(h->radix & 1); h->radix >>= 1)
+    {
+        h->log2p++;
+    }
+    p = 1 << h->log2p;
+    h->lut = tricl_fft_lut_acquire(h->log2p);
+    h->twid = malloc(2 * p * sizeof(real));
+    if (h->log2p > 27 || !h->lut || !h->twid)
+    {
+        tricl_fft_mixed_free(h);
+        return NULL;
+    }
+    for (j = 0; j < p; j++)
+    {
+        h->twid[2*j + 0] = (real)cos(2 * PI * j / n);
+        h->twid[2*j + 1] = (real)sin(2 * PI * j / n);
+    }
+    for (j = 0; 2*j < h->radix; j++)
+    {
+        for (k = 0; 2*k < h->radix; k++)
+        {
+            h->cs[j][k][0] = cos(2 * PI * (j*k % h->radix) / h->radix);
+            h->cs[j][k][1] = sin(2 * PI * (j*k % h->radix) / h->radix);
+        }
+    }
+    return h;
+}
+
+void tricl_fft_mixed_free(tricl_fft_mixed_t * h)
+{
+    if (h)
+    {
+        tricl_fft_lut_release(h->lut);
+        free(h->twid);
+        free(h);
+    }
+}
+
+/**
+*   Position of sample p in tricl_fft_r2c() input (halves interleaved)
+*/
+#define R2C_POS(p, half) ((p) < (half) ? 2*(p) : 2*((p) - (half)) + 1)
+
+void tricl_fft_mixed_r2c(tricl_fft_mixed_t * h, const real * x, real * X)
+{
+    int r = h->radix, m = r / 2, p = 1 << h->log2p;
+    int i, j, k;
+
+    assert(x != X);
+    for (i = 0; i < p; i++)
+    {
+        double s[MIXED_RADIX_MAX/2 + 1], d[MIXED_RADIX_MAX/2 + 1];
+        double wr = h->twid[2*i], wi = h->twid[2*i + 1];
+        double tr = 1, ti = 0, t;
+        double u0 = s[0] = x[i];
+
+        // Real input: pairs x[j] +- x[r-j]
+        for (j = 1; j <= m; j++)
+        {
+            s[j] = (double)x[i + p*j] + x[i + p*(r - j)];
+            d[j] = (double)x[i + p*j] - x[i + p*(r - j)];
+            u0 += s[j];
+        }
+        X[R2C_POS(i, p/2)] = (real)u0;
+        for (k = 1; k <= m; k++)
+        {
+            double ur = s[0], ui = 0;
+            real * y = X + p*(2*k - 1) + 2*i;
+            for (j = 1; j <= m; j++)
+            {
+                ur += s[j] * h->cs[j][k][0];
+                ui += d[j] * h->cs[j][k][1];
+            }
+            // W(n)^(i*k), by recurrence: k is small
+            t  = tr*wr - ti*wi;
+            ti = tr*wi + ti*wr;
+            tr = t;
+            y[0] = (real)(ur*tr - ui*ti);
+            y[1] = (real)(ur*ti + ui*tr);
+        }
+    }
+
+    tricl_fft_r2c(X, h->log2p, h->lut);
+    for (k = 1; k <= m; k++)
+    {
+        tricl_fft_fft(X + p*(2*k - 1), h->log2p, h->lut);
+    }
+}
+
+void tricl_fft_mixed_c2r(tricl_fft_mixed_t * h, real * X, real * x)
+{
+    int r = h->radix, m = r / 2, p = 1 << h->log2p;
+    int i, j, k;
+
+    assert(x != X);
+    X[0] *= 0.5;                                // DC and Nyquist, see tricl_fft_r2c_scale()
+    X[1] *= 0.5;
+    tricl_fft_c2r(X, h->log2p, h->lut);
+    for (k = 1; k <= m; k++)
+    {
+        tricl_fft_ifft(X + p*(2*k - 1), h->log2p, h->lut);
+    }
+
+    // x[i + P*j] = u_0 + 2*Re(sum(u_k * W(n)^-(i*k) * W(R)^-(j*k))); tricl_fft_c2r()
+    // scale is half of tricl_fft_ifft()
+    for (i = 0; i < p; i++)
+    {
+        double vr[MIXED_RADIX_MAX/2 + 1], vi[MIXED_RADIX_MAX/2 + 1];
+        double wr = h->twid[2*i], wi = h->twid[2*i + 1];
+        double tr = 1, ti = 0, t;
+        double u0 = 2 * (double)X[R2C_POS(i, p/2)];
+        double sum = u0;
+
+        for (k = 1; k <= m; k++)
+        {
+            const real * y = X + p*(2*k - 1) + 2*i;
+            t  = tr*wr - ti*wi;
+            ti = tr*wi + ti*wr;
+            tr = t;
+            vr[k] = 2 * ((double)y[0]*tr + (double)y[1]*ti);
+            vi[k] = 2 * ((double)y[1]*tr - (double)y[0]*ti);
+            sum += vr[k];
+        }
+        x[i] = (real)sum;
+        for (j = 1; j <= m; j++)
+        {
+            double c = u0, s = 0;
+            for (k = 1; k <= m; k++)
+            {
+                c += vr[k] * h->cs[j][k][0];
+                s += vi[k] * h->cs[j][k][1];
+            }
+            x[i + p*j] = (real)(c + s);
+            x[i + p*(r - j)] = (real)(c - s);
+        }
+    }
+}
+
+void tricl_fft_mixed_mulpr_conj(tricl_fft_mixed_t * h, real * X, real * Y)
+{
+    int k, p = 1 << h->log2p;
+    tricl_fftconv_mulpr_conj(X, Y, h->log2p);
+    for (k = 1; 2*k < h->radix; k++)
+    {
+        tricl_fftconv_mulpw_conj(X + p*(2*k - 1), Y + p*(2*k - 1), h->log2p);
+    }
+}
+
+#undef R2C_POS
+
+
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+*   Batched real transforms of k interleaved signals (PCM frames). Channels
+*   go in pairs into the real and imaginary lanes of one complex tricl_fft_fft()
+*   of n points, so that vectorized and threaded butterflies serve two
+*   channels at once, and stereo input is taken as is:
+*
+*       Z = FFT(x_2p + i*x_2p+1),  X_2p = (Z(f) + conj(Z(-f)))/2,
+*                                  X_2p+1 = (Z(f) - conj(Z(-f)))/2i
+*
+*   Spectra of the pair are not separated: per channel operations combine
+*   Z(f) and Z(-f). In tricl_fft_fft() order, f and -f are at positions
+*   0, 1 (self), and then at the two halves of each block [2^j, 2^(j+1)):
+*   2^j + r and 2^j + 2^(j-1) + pair(r), where pair() is the same map over
+*   positions below 2^(j-1). Odd channel left is transformed as real one,
+*   as tricl_fft_xcorr() does, so the spectrum is k*n reals.
+*/
+#define BATCH_LOG_MIN XCORR_LOG_MIN
+
+struct tricl_fft_batch_t
+{
+    int logn;                                   // transform size, 2^logn frames
+    int k;                                      // channels
+    const real * lut;                           // shared, see tricl_fft_lut_acquire()
+};
+
+/**
+*   X = X * conj(Y) per channel over pairs of runs at p and q, len complex
+*   values each, scaled by 1/4 of two spectra separation
+*/
+static void batch_mulpr_conj_run(real * X, const real * Y, size_t p, size_t q, size_t len)
+{
+    size_t t;
+    real * xp = X + 2*p;
+    real * xq = X + 2*q;
+    const real * yp = Y + 2*p;
+    const real * yq = Y + 2*q;
+
+    for (t = 0; t < 2*len; t += 2)
+    {
+        // A = Zx(f), B = conj(Zx(-f)), C, D the same of Y:
+        // X_2p * conj(Y_2p) = (A + B) * conj(C + D) / 4,
+        // X_2p+1 * conj(Y_2p+1) = (A - B) * conj(C - D) / 4
+        real sr = xp[t] + xq[t], si = xp[t + 1] - xq[t + 1];
+        real dr = xp[t] - xq[t], di = xp[t + 1] + xq[t + 1];
+        real cr = yp[t] + yq[t], ci = yp[t + 1] - yq[t + 1];
+        real er = yp[t] - yq[t], ei = yp[t + 1] + yq[t + 1];
+        real ar = (sr*cr + si*ci) * (real)0.25;
+        real ai = (si*cr - sr*ci) * (real)0.25;
+        real br = (dr*er + di*ei) * (real)0.25;
+        real bi = (di*er - dr*ei) * (real)0.25;
+
+        // Products are Hermitian: a + i*b at f, conj(a) + i*conj(b) at -f
+        xp[t]     = ar - bi;
+        xp[t + 1] = ai + br;
+        xq[t]     = ar + bi;
+        xq[t + 1] = br - ai;
+    }
+}
+
+/**
+*   Call batch_mulpr_conj_run() for positions a + r, paired with b + pair(r),
+*   r < h, where pair() is the map of f to -f positions below h
+*/
+static void batch_mulpr_conj_map(real * X, const real * Y, size_t a, size_t b, size_t h)
+{
+    size_t i;
+    batch_mulpr_conj_run(X, Y, a, b, h < 2 ? h : 2);
+    for (i = 2; i < h; i *= 2)
+    {
+        batch_mulpr_conj_map(X, Y, a + i, b + i + i/2, i/2);
+        batch_mulpr_conj_map(X, Y, a + i + i/2, b + i, i/2);
+    }
+}
+
+tricl_fft_batch_t * tricl_fft_batch_alloc(int n, int k)
+{
+    tricl_fft_batch_t * h;
+    int logn = 0;
+
+    while ((1 << logn) < n && logn < 30)
+    {
+        logn++;
+    }
+    if (n != 1 << logn || logn < BATCH_LOG_MIN || logn > 27 || k < 1)
+    {
+        return NULL;
+    }
+    h = calloc(1, sizeof(tricl_fft_batch_t));
+    if (!h)
+    {
+        return NULL;
+    }
+    h->logn = logn;
+    h->k = k;
+    h->lut = tricl_fft_lut_acquire(logn);
+    if (!h->lut)
+    {
+        tricl_fft_batch_free(h);
+        return NULL;
+    }
+    return h;
+}
+
+void tricl_fft_batch_free(tricl_fft_batch_t * h)
+{
+    if (h)
+    {
+        tricl_fft_lut_release(h->lut);
+        free(h);
+    }
+}
+
+/**
+*   Pairs of channels of nx frames x, zero-padded to n, to complex arrays
+*   of X, then forward transforms
+*/
+#define TRICL_FFT_BATCH_R2C(NAME, T)                                        \
+void NAME(tricl_fft_batch_t * h, const T * x, int nx, real * X)             \
+{                                                                           \
+    size_t n = (size_t)1 << h->logn, m;                                     \
+    int k = h->k, c;                                                        \
+                                                                            \
+    assert((const void *)x != (const void *)X);                             \
+    nx = nx < (int)n ? nx : (int)n;                                         \
+    for (c = 0; c + 1 < k; c += 2)                                          \
+    {                                                                       \
+        real * z = X + n*c;                                                 \
+        const T * s = x + c;                                                \
+        for (m = 0; m < (size_t)nx; m++, s += k)                            \
+        {                                                                   \
+            z[2*m + 0] = (real)s[0];                                        \
+            z[2*m + 1] = (real)s[1];                                        \
+        }                                                                   \
+        memset(z + 2*m, 0, 2*(n - m) * sizeof(real));                       \
+        tricl_fft_fft(z, h->logn, h->lut);                                  \
+    }                                                                       \
+    if (c < k)                                                              \
+    {                                                                       \
+        real * z = X + n*c;                                                 \
+        xcorr_rpass_ ## T(z, x + c, nx, k, h->logn, h->lut);                \
+        tricl_fft_r2c(z, h->logn - 1, h->lut);                              \
+        tricl_fft_fft(z + n/2, h->logn - 2, h->lut);                        \
+    }                                                                       \
+}
+
+TRICL_FFT_BATCH_R2C(tricl_fft_batch_r2c, real)
+TRICL_FFT_BATCH_R2C(tricl_fft_batch_r2c_float, float)
+
+#undef TRICL_FFT_BATCH_R2C
+
+void tricl_fft_batch_c2r(tricl_fft_batch_t * h, real * X, real * x)
+{
+    size_t n = (size_t)1 << h->logn, m;
+    int k = h->k, c;
+
+    assert(x != X);
+    for (c = 0; c + 1 < k; c += 2)
+    {
+        real * z = X + n*c;
+        real * d = x + c;
+        tricl_fft_ifft(z, h->logn, h->lut);
+        for (m = 0; m < n; m++, d += k)
+        {
+            d[0] = z[2*m + 0];
+            d[1] = z[2*m + 1];
+        }
+    }
+    if (c < k)
+    {
+        real * z = X + n*c;
+        tricl_fft_ifft(z + n/2, h->logn - 2, h->lut);
+        tricl_fft_c2r(z, h->logn - 1, h->lut);
+        xcorr_vpass(x + c, k, z, h->logn, h->lut);
+    }
+}
+
+void tricl_fft_batch_mulpr_conj(tricl_fft_batch_t * h, real * X, const real * Y)
+{
+    size_t n = (size_t)1 << h->logn, lower;
+    int k = h->k, c;
+
+    for (c = 0; c + 1 < k; c += 2)
+    {
+        real * x = X + n*c;
+        const real * y = Y + n*c;
+        batch_mulpr_conj_run(x, y, 0, 0, 1);
+        batch_mulpr_conj_run(x, y, 1, 1, 1);
+        for (lower = 2; lower < n; lower *= 2)
+        {
+            batch_mulpr_conj_map(x, y, lower, lower + lower/2, lower/2);
+        }
+    }
+    if (c < k)
+    {
+        // tricl_fft_c2r() scale is half of tricl_fft_ifft()
+        xcorr_mul(X + n*c, X + n*c, Y + n*c, h->logn, 2.0);
+    }
+}
+
+
 #ifdef dsp_ffttricl_test
 /******************************************************************************
 !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
@@ -2959,6 +4227,8 @@ int main(int argc, char* argv[])
     return 0;
 }
 
-// dmc dsp_ffttricl.c -Ddsp_ffttricl_test && dsp_ffttricl.exe && del *.obj *.map dsp_ffttricl.exe
+// dmc dsp_ffttricl_d.c -Ddsp_ffttricl_test && dsp_ffttricl_d.exe && del *.obj *.map dsp_ffttricl_d.exe
 
 #endif //dsp_ffttricl_test
+
+#endif //TRICL_INSTANCE
@@ -14,123 +14,102 @@ extern "C" {
 
 #include "type_real.h"
 
-
-/**T
-The function {\em tricl\_fft\_makelut}($LUT$, $n$) generates an FFT 
-lookup table suitable for use in computing FFTs of length up to $2^n$.
-The input $n$ must satisfy $0 \leq n \leq 29$, and $LUT$ must have 
-space to store $2^n$ doubles (i.e., $2^{n + 3}$ bytes).
-*/
-
-void tricl_fft_makelut(real *, int);
-
-/**T
-The function {\em tricl\_fft\_fft}($DAT$, $n$, $LUT$) computes a length
-$2^n$ in-place FFT on the values $z_k$ where $z_k = \textrm{DAT}_{2 k} +
-\textrm{DAT}_{2 k + 1} i$, using the precomputed lookup table $LUT$, leaving
-the output in a wacky order.  The input $n$ must satisfy $0 \leq n \leq 29$,
-$DAT$ must be an array of $2^n$ complex values ($2^{n + 1}$ doubles), and
-$LUT$ must be as created by {\em tricl\_fft\_makelut}($LUT$, $m$) for some
-$m \geq n$.
-*/
-void tricl_fft_fft(real * __restrict, int, const real * __restrict);
-
-/**T
-The function {\em tricl\_fft\_ifft}($DAT$, $n$, $LUT$) computes an inverse
-FFT corresponding to {\em tricl\_fft\_fft}; it takes its input in the wacky
-order from the output of that function, and leaves its output in normal order.
-*/
-void tricl_fft_ifft(real * __restrict, int, const real * __restrict);
-void tricl_fft_r2c(real * __restrict, int, const real * __restrict);
-void tricl_fft_c2r(real * __restrict, int, const real * __restrict);
-
-/**T
-The function {\em tricl\_fftconv\_scale}($DAT$, $n$) multiplies the 
-$2^n$ complex values ($2^{n + 1}$ doubles) stored in $DAT$ by $2^{-n}$.
+/**
+*   The library is built twice (dsp_ffttricl_f.c, dsp_ffttricl_d.c): single
+*   precision functions are named tricl_f_*, double precision - tricl_d_*.
+*   Names below (tricl_fft_fft etc.) select the precision of `real`
+*   (SIZEOF_REAL), so that code, written for `real`, is not changed:
+*
+*   tricl_fft_r2c(x, n, lut);           // real x[], lut[]
+*   tricl_f_fft_r2c(xf, n, lutf);       // float xf[], lutf[]
 */
-void tricl_fftconv_scale(real *, int);
-
-/**T
-The function {\em tricl\_fftconv\_mulpw}($DAT1$, $DAT2$, $n$) computes 
-the product of $2^n$ pairs of complex values from $DAT1$ and $DAT2$ and
-writes the resulting values into $DAT1$.
-*/
-void tricl_fftconv_mulpw(real * __restrict, real * __restrict, int);
-void tricl_fftconv_mulpr(real * __restrict, real * __restrict, int);
-void tricl_fftconv_mulpr_conj(real * __restrict DAT1, real * __restrict DAT2, int n);
-
-/**T
-The function {\em tricl\_fft\_sqrpw}($DAT$, $n$) squares $2^n$ complex
-values from $DAT$ and writes the resulting values into $DAT$.
+#define tricl_fft_makelut                    TRICL_NAME(fft_makelut)
+#define tricl_fft_lut_acquire                TRICL_NAME(fft_lut_acquire)
+#define tricl_fft_lut_release                TRICL_NAME(fft_lut_release)
+#define tricl_fft_lut_purge                  TRICL_NAME(fft_lut_purge)
+#define tricl_fft_set_isa                    TRICL_NAME(fft_set_isa)
+#define tricl_fft_set_threads                TRICL_NAME(fft_set_threads)
+#define tricl_fft_fft                        TRICL_NAME(fft_fft)
+#define tricl_fft_ifft                       TRICL_NAME(fft_ifft)
+#define tricl_fft_r2c                        TRICL_NAME(fft_r2c)
+#define tricl_fft_c2r                        TRICL_NAME(fft_c2r)
+#define tricl_fftconv_scale                  TRICL_NAME(fftconv_scale)
+#define tricl_fftconv_mulpw                  TRICL_NAME(fftconv_mulpw)
+#define tricl_fftconv_mulpw_conj             TRICL_NAME(fftconv_mulpw_conj)
+#define tricl_fftconv_mulpr                  TRICL_NAME(fftconv_mulpr)
+#define tricl_fftconv_mulpr_conj             TRICL_NAME(fftconv_mulpr_conj)
+#define tricl_fftconv_sqrpw                  TRICL_NAME(fftconv_sqrpw)
+#define tricl_roots_makelut                  TRICL_NAME(roots_makelut)
+#define tricl_fft_r2c_scale                  TRICL_NAME(fft_r2c_scale)
+#define tricl_fft_r2c_preproc                TRICL_NAME(fft_r2c_preproc)
+#define tricl_fft_c2r_postproc               TRICL_NAME(fft_c2r_postproc)
+#define tricl_fft2d                          TRICL_NAME(fft2d)
+#define tricl_ifft2d                         TRICL_NAME(ifft2d)
+#define tricl_fft2dconv_mulpw                TRICL_NAME(fft2dconv_mulpw)
+#define tricl_fft_real_spectr_t              TRICL_NAME(fft_real_spectr_t)
+#define tricl_fft_real_spectr_mem_alloc      TRICL_NAME(fft_real_spectr_mem_alloc)
+#define tricl_fft_real_spectr_free           TRICL_NAME(fft_real_spectr_free)
+#define tricl_fft_r2spec                     TRICL_NAME(fft_r2spec)
+#define tricl_fft_r2power                    TRICL_NAME(fft_r2power)
+#define tricl_fft_power2db                   TRICL_NAME(fft_power2db)
+#define tricl_fft_bluestein                  TRICL_NAME(fft_bluestein)
+#define tricl_fft_bluestein_ex               TRICL_NAME(fft_bluestein_ex)
+#define tricl_fft_bluestein_t                TRICL_NAME(fft_bluestein_t)
+#define tricl_fft_bluestein_alloc            TRICL_NAME(fft_bluestein_alloc)
+#define tricl_fft_bluestein_free             TRICL_NAME(fft_bluestein_free)
+#define tricl_fft_bluestein_r2c              TRICL_NAME(fft_bluestein_r2c)
+#define tricl_fft_bluestein_c2r              TRICL_NAME(fft_bluestein_c2r)
+#define tricl_fft_chirpz_t                   TRICL_NAME(fft_chirpz_t)
+#define tricl_fft_chirpz_free                TRICL_NAME(fft_chirpz_free)
+#define tricl_fft_chirpz_alloc               TRICL_NAME(fft_chirpz_alloc)
+#define tricl_fft_chirpz                     TRICL_NAME(fft_chirpz)
+#define tricl_fft_xcorr                      TRICL_NAME(fft_xcorr)
+#define tricl_fft_xcorr_float                TRICL_NAME(fft_xcorr_float)
+#define tricl_fft_mixed_size                 TRICL_NAME(fft_mixed_size)
+#define tricl_fft_mixed_t                    TRICL_NAME(fft_mixed_t)
+#define tricl_fft_mixed_alloc                TRICL_NAME(fft_mixed_alloc)
+#define tricl_fft_mixed_free                 TRICL_NAME(fft_mixed_free)
+#define tricl_fft_mixed_r2c                  TRICL_NAME(fft_mixed_r2c)
+#define tricl_fft_mixed_c2r                  TRICL_NAME(fft_mixed_c2r)
+#define tricl_fft_mixed_mulpr_conj           TRICL_NAME(fft_mixed_mulpr_conj)
+#define tricl_fft_batch_t                    TRICL_NAME(fft_batch_t)
+#define tricl_fft_batch_alloc                TRICL_NAME(fft_batch_alloc)
+#define tricl_fft_batch_free                 TRICL_NAME(fft_batch_free)
+#define tricl_fft_batch_r2c                  TRICL_NAME(fft_batch_r2c)
+#define tricl_fft_batch_r2c_float            TRICL_NAME(fft_batch_r2c_float)
+#define tricl_fft_batch_c2r                  TRICL_NAME(fft_batch_c2r)
+#define tricl_fft_batch_mulpr_conj           TRICL_NAME(fft_batch_mulpr_conj)
+#define fftfreq_c                            TRICL_NAME(fftfreq_c)
+#define fftfreq_ctable                       TRICL_NAME(fftfreq_ctable)
+#define fftfreq_r                            TRICL_NAME(fftfreq_r)
+#define fftfreq_rtable                       TRICL_NAME(fftfreq_rtable)
+
+/**
+*   Instruction sets of FFT butterflies, see tricl_fft_set_isa()
 */
-void tricl_fftconv_sqrpw(real *, int);
-
-
-// Return frequency-domain index of element i after complex transform with size = n
-extern unsigned int fftfreq_c(unsigned int i, unsigned int n);
-
-// Generates permutation table for complex transform
-extern void fftfreq_ctable(unsigned int *,unsigned int);
-
-// Return frequency-domain index of element i after real-to-complex transform with size = n
-extern unsigned int fftfreq_r(unsigned int i, unsigned int n);
-
-// Generates permutation table for real-to-complex transform
-extern void fftfreq_rtable(unsigned int *,unsigned int);
-
-// Scales real-to-complex transform in frequency domain, such that IFFT(Scale(FFT(x))) = x
-void tricl_fft_r2c_scale(real * dat, int logn);
-
-// Reorders input before real-to-complex transform, must be used!
-real * tricl_fft_r2c_preproc(const real * dat, int logn, real * out);
-
-// Reorders output after complex-to-real transform, must be used!
-real * tricl_fft_c2r_postproc(const real * dat, int logn, real * out);
-
-// 2D FFT
-void tricl_fft2d(real * out, const real * inp, int logx, int logy, int w, int h,  const real * twid);
-
-// 2D IFFT
-void tricl_ifft2d(real * out, real * inp, int logx, int logy, int w, int h, const real * twid);
-
-// 2D convolution helper
-void tricl_fft2dconv_mulpw(real * __restrict DAT1, real * __restrict DAT2, int n);
-
-
-typedef struct tricl_fft_real_spectr_t tricl_fft_real_spectr_t;
-tricl_fft_real_spectr_t * tricl_fft_real_spectr_mem_alloc(int n);
-real * tricl_fft_r2spec(tricl_fft_real_spectr_t * h, const real * x);
-real * tricl_fft_r2power(tricl_fft_real_spectr_t * h, const real * x);
-void tricl_fft_power2db(const real * x, real * db, int n, double dbm0, double floor);
-
-
-void tricl_fft_bluestein(real * x, int xsize, int sign, real  * out);
-void tricl_fft_bluestein_ex(real * x, int xsize, double freq_scalefactor, real  * out);
-
-typedef struct tricl_fft_bluestein_t tricl_fft_bluestein_t;
-tricl_fft_bluestein_t * tricl_fft_bluestein_alloc(int n);
-void tricl_fft_bluestein_free(tricl_fft_bluestein_t * h);
-void tricl_fft_bluestein_r2c(tricl_fft_bluestein_t * h, const real * x, real * out);
-void tricl_fft_bluestein_c2r(tricl_fft_bluestein_t * h, const real * x, real * out);
-
-
-
-
-typedef struct 
-{
-    int nfft;      // radix-2 transform size
-    int log2nfft;  // 
-    int ntime;
-    int mfreq;
-    real * lut;
-    real * chirp_time1;
-    real * chirp_time2;
-    real * chirp_freq;
-} tricl_fft_chirpz_t;
-
-void tricl_fft_chirpz_free(tricl_fft_chirpz_t * h);
-tricl_fft_chirpz_t * tricl_fft_chirpz_alloc(int n, int m, const real a[2], const real w[2], real freq_scalefactor);
-void tricl_fft_chirpz(tricl_fft_chirpz_t * h, real * x, real  * out);
+#define TRICL_ISA_C         0                   //!< Portable C
+#define TRICL_ISA_SSE2      1
+#define TRICL_ISA_AVX2      2                   //!< AVX2 and FMA
+#define TRICL_ISA_AVX512    3                   //!< AVX-512F
+#define TRICL_ISA_MAX       TRICL_ISA_AVX512
+
+#define real float
+#define TRICL_NAME(x) tricl_f_ ## x
+#include "dsp_ffttricl_api.h"
+#undef TRICL_NAME
+#undef real
+
+#define real double
+#define TRICL_NAME(x) tricl_d_ ## x
+#include "dsp_ffttricl_api.h"
+#undef TRICL_NAME
+#undef real
+
+#if SIZEOF_REAL == 4
+#   define TRICL_NAME(x) tricl_f_ ## x
+#else
+#   define TRICL_NAME(x) tricl_d_ ## x
+#endif
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,572 @@
+/** 18.10.2026 @file
+*   Speed and accuracy benchmark of TRICL FFT, and latency of the alignment
+*   built on it. Results are printed to stdout as JSON, so that runs before
+*   and after a change can be compared by a script.
+*
+*   Transform errors are relative to the long double DFT, evaluated at all
+*   bins of small transforms and at CHECK_BINS bins of large ones. Inverse
+*   real transform error is the round trip error. GFLOP/s are nominal, as
+*   for radix-2 transform of the same size: 5 n log2(n) operations complex,
+*   half of it real.
+*
+*   gcc -O2 -Ddsp_ffttricl_bench -I. -Icompat -owd_bench *.c -lm -lpthread
+*   wd_bench [-min<log2n>] [-max<log2n>] [-t<seconds>] [-isa<int>] [-threads<int>] [-align<samples>]
+*
+*   Options: transform sizes 2^min..2^max (8..24); min run time of one
+*   measurement (0.05 s); instruction set limit, TRICL_ISA_* (best); threads
+*   (0 - one per CPU); max alignment range (1000000, 0 - skip alignment).
+*   Build with -DSIZEOF_REAL=4 for single precision transforms.
+*/
+#ifdef dsp_ffttricl_bench
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include "dsp_ffttricl.h"
+#include "f_wav_align.h"
+
+#define PI_L                3.141592653589793238462643383279503L
+#define CHECK_ALL           1024                //!< Max transform size, checked at all bins
+#define CHECK_BINS          32                  //!< Bins, checked in larger transforms
+#define RESEED              64                  //!< Reference twiddles recurrence, exact twiddle period
+#define RUNS                3                   //!< Measurements, the fastest one is reported
+#define CHIRPZ_ZOOM         0.5                 //!< Chirp-z frequency scale: lower half of the band
+#define ALIGN_RANGE_MIN     1000                //!< Smallest alignment range, samples
+#define ALIGN_LEN           (1 << 20)           //!< Alignment test files, beyond 2 ranges, samples
+#define ALIGN_CH            2
+#define ALIGN_HZ            44100
+#define SQR(x)              ((x)*(x))
+#define MAX( x, y )         ( (x)>(y)?(x):(y) )
+
+/**
+*   Transforms of one size, with their buffers
+*/
+typedef struct
+{
+    int                     logn;
+    int                     n;                  //!< Transform size (Bluestein and chirp-z: 3/4 of 2^logn)
+    const real *            lut;
+    real *                  x;                  //!< Input, 2n: complex, or real in the first n
+    real *                  spec;               //!< Real transform, n
+    real *                  y;                  //!< Output and work, 2n
+    real *                  out;                //!< Inverse real transform, n
+    size_t                  copy;               //!< op_copy() size, reals
+    tricl_fft_bluestein_t * bluestein;
+    tricl_fft_chirpz_t *    chirpz;
+} bench_t;
+
+/**
+*   Error accumulator
+*/
+typedef struct
+{
+    double                  max;                //!< Max error magnitude
+    double                  err2;               //!< Sum of squared errors
+    double                  ref2;               //!< Sum of squared reference values
+    size_t                  count;
+} bench_error_t;
+
+typedef void (* bench_op_t)(bench_t * b);
+
+
+static double time_sec(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER f, t;
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart / f.QuadPart;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + 1e-9 * t.tv_nsec;
+#endif
+}
+
+
+/**
+*   @return time of one call, seconds: the fastest of RUNS runs, each of
+*   which lasts about minTime or more
+*/
+static double time_op(bench_op_t op, bench_t * b, double minTime)
+{
+    double t, best = 0;
+    long i, reps = 1;
+    int run;
+
+    // Calls per run
+    for (;;)
+    {
+        double t0 = time_sec();
+        for (i = 0; i < reps; i++)
+        {
+            op(b);
+        }
+        t = time_sec() - t0;
+        if (t >= minTime / 2)
+        {
+            break;
+        }
+        reps = t > 0 && minTime / t < 10 ? (long)(reps * minTime / t) + 1 : reps * 10;
+    }
+    reps = t < minTime ? (long)(reps * minTime / t) + 1 : reps;
+
+    for (run = 0; run < RUNS; run++)
+    {
+        double t0 = time_sec();
+        for (i = 0; i < reps; i++)
+        {
+            op(b);
+        }
+        t = (time_sec() - t0) / reps;
+        if (!run || t < best)
+        {
+            best = t;
+        }
+    }
+    return best;
+}
+
+
+static void op_copy(bench_t * b)
+{
+    memcpy(b->y, b->x, b->copy * sizeof(real));
+}
+
+static void op_fft(bench_t * b)
+{
+    memcpy(b->y, b->x, 2 * b->n * sizeof(real));
+    tricl_fft_fft(b->y, b->logn, b->lut);
+}
+
+static void op_r2c(bench_t * b)
+{
+    tricl_fft_r2c_preproc(b->x, b->logn, b->y);
+    tricl_fft_r2c(b->y, b->logn, b->lut);
+}
+
+static void op_c2r(bench_t * b)
+{
+    memcpy(b->y, b->spec, b->n * sizeof(real));
+    tricl_fft_c2r(b->y, b->logn, b->lut);
+    tricl_fft_c2r_postproc(b->y, b->logn, b->out);
+}
+
+static void op_bluestein(bench_t * b)
+{
+    tricl_fft_bluestein_r2c(b->bluestein, b->x, b->y);
+}
+
+static void op_chirpz(bench_t * b)
+{
+    tricl_fft_chirpz(b->chirpz, b->x, b->y);
+}
+
+
+/**
+*   Long double DFT bin: sum(x[j] * exp(2*pi*i * j * freq / n)), with the
+*   sign of TRICL forward transforms. Complex x if cpx, real otherwise.
+*/
+static void ref_dft(const real * x, int cpx, int n, double freq, long double * re, long double * im)
+{
+    long double sr = 0, si = 0, wr = 1, wi = 0;
+    long double cr = cosl(2*PI_L*freq/n);
+    long double ci = sinl(2*PI_L*freq/n);
+    int j;
+    for (j = 0; j < n; j++)
+    {
+        long double xr = cpx ? x[2*j] : x[j];
+        long double xi = cpx ? x[2*j + 1] : 0;
+        long double t;
+        if (j % RESEED == 0)
+        {
+            // freq * j is exact: no phase error accumulates
+            long double phase = 2*PI_L*fmodl((long double)freq * j, n)/n;
+            wr = cosl(phase);
+            wi = sinl(phase);
+        }
+        sr += xr*wr - xi*wi;
+        si += xr*wi + xi*wr;
+        t = wr*cr - wi*ci;
+        wi = wr*ci + wi*cr;
+        wr = t;
+    }
+    *re = sr;
+    *im = si;
+}
+
+
+static void error_add(bench_error_t * e, double re, double im, long double refRe, long double refIm)
+{
+    double d = (double)sqrtl(SQR(re - refRe) + SQR(im - refIm));
+    e->max = MAX(e->max, d);
+    e->err2 += SQR(d);
+    e->ref2 += (double)(SQR(refRe) + SQR(refIm));
+    e->count++;
+}
+
+
+/**
+*   Index of the checked bin of count ones
+*/
+static int check_bin(int i, int count)
+{
+    return count <= CHECK_ALL ? i : (int)((double)i * (count - 1) / (CHECK_BINS - 1));
+}
+
+static int check_count(int count)
+{
+    return count <= CHECK_ALL ? count : CHECK_BINS;
+}
+
+
+/**
+*   Complex transform output is in TRICL order: position p holds bin fftfreq_c(p)
+*/
+static void check_fft(const bench_t * b, bench_error_t * e)
+{
+    int i, count = check_count(b->n);
+    for (i = 0; i < count; i++)
+    {
+        int p = check_bin(i, b->n);
+        long double re, im;
+        ref_dft(b->x, 1, b->n, fftfreq_c(p, b->n), &re, &im);
+        error_add(e, b->y[2*p], b->y[2*p + 1], re, im);
+    }
+}
+
+/**
+*   Real transform output is n/2 complex values in TRICL order: position 0
+*   holds DC and Nyquist bins, position p > 0 - bin fftfreq_r(2p) or its
+*   conjugate (see tricl_fft_r2c_reorder()).
+*/
+static void check_r2c(const bench_t * b, bench_error_t * e)
+{
+    int i, n = b->n, count = check_count(n/2);
+    for (i = 0; i < count; i++)
+    {
+        int p = check_bin(i, n/2);
+        long double re, im;
+        if (!p)
+        {
+            ref_dft(b->x, 0, n, 0, &re, &im);
+            error_add(e, b->y[0], 0, re, im);
+            ref_dft(b->x, 0, n, n/2, &re, &im);
+            error_add(e, b->y[1], 0, re, im);
+        }
+        else
+        {
+            int k = (int)fftfreq_r(2*p, n);
+            if (k >= n/2)
+            {
+                ref_dft(b->x, 0, n, n - k, &re, &im);
+                error_add(e, b->y[2*p], -b->y[2*p + 1], re, im);
+            }
+            else
+            {
+                ref_dft(b->x, 0, n, k, &re, &im);
+                error_add(e, b->y[2*p], b->y[2*p + 1], re, im);
+            }
+        }
+    }
+}
+
+/**
+*   Round trip of the real transform
+*/
+static void check_c2r(const bench_t * b, bench_error_t * e)
+{
+    int i;
+    for (i = 0; i < b->n; i++)
+    {
+        error_add(e, b->out[i], 0, b->x[i], 0);
+    }
+}
+
+/**
+*   Bluestein real transform gives bins 0..n/2 in natural order
+*/
+static void check_bluestein(const bench_t * b, bench_error_t * e)
+{
+    int i, count = check_count(b->n/2 + 1);
+    for (i = 0; i < count; i++)
+    {
+        int k = check_bin(i, b->n/2 + 1);
+        long double re, im;
+        ref_dft(b->x, 0, b->n, k, &re, &im);
+        error_add(e, b->y[2*k], b->y[2*k + 1], re, im);
+    }
+}
+
+/**
+*   Chirp-z gives n bins, CHIRPZ_ZOOM of DFT bin apart, in natural order
+*/
+static void check_chirpz(const bench_t * b, bench_error_t * e)
+{
+    int i, count = check_count(b->n);
+    for (i = 0; i < count; i++)
+    {
+        int k = check_bin(i, b->n);
+        long double re, im;
+        ref_dft(b->x, 1, b->n, k * CHIRPZ_ZOOM, &re, &im);
+        error_add(e, b->y[2*k], b->y[2*k + 1], re, im);
+    }
+}
+
+
+static void print_result(const char * name, const bench_t * b, double sec, double flops, const bench_error_t * e, int * first)
+{
+    double rms = e->count ? sqrt(e->ref2 / e->count) : 0;
+    printf("%s\n    {\"transform\": \"%s\", \"log2n\": %d, \"n\": %d, \"ns_per_point\": %.4g, \"gflops\": %.4g, "
+        "\"max_err\": %.3e, \"rms_err\": %.3e}",
+        *first ? "" : ",", name, b->logn, b->n, 1e9 * sec / b->n, sec > 0 ? 1e-9 * flops / sec : 0,
+        rms > 0 ? e->max / rms : 0, e->ref2 > 0 ? sqrt(e->err2 / e->ref2) : 0);
+    *first = 0;
+}
+
+
+/**
+*   Time and check one transform
+*/
+static void bench_one(const char * name, bench_t * b, bench_op_t op, void (* check)(const bench_t *, bench_error_t *),
+    size_t copy, double flops, double minTime, int * first)
+{
+    bench_error_t e = {0};
+    double sec, copySec = 0;
+    if (copy)
+    {
+        // Input copy, made by op() before in-place transform, is not counted
+        b->copy = copy;
+        copySec = time_op(op_copy, b, minTime);
+    }
+    sec = time_op(op, b, minTime) - copySec;
+    check(b, &e);
+    print_result(name, b, MAX(sec, 0), flops, &e, first);
+    fflush(stdout);
+}
+
+
+static void bench_free(bench_t * b)
+{
+    free(b->x);
+    free(b->spec);
+    free(b->y);
+    free(b->out);
+    if (b->bluestein)
+    {
+        tricl_fft_bluestein_free(b->bluestein);
+    }
+    if (b->chirpz)
+    {
+        tricl_fft_chirpz_free(b->chirpz);
+    }
+    if (b->lut)
+    {
+        tricl_fft_lut_release(b->lut);
+    }
+    memset(b, 0, sizeof(*b));
+}
+
+
+/**
+*   Benchmark transforms of size 2^logn
+*   @return 0 if no memory
+*/
+static int bench_size(int logn, double minTime, int * first)
+{
+    bench_t b = {0};
+    double nlogn;
+    int i, ok;
+
+    b.logn = logn;
+    b.n = 1 << logn;
+    b.lut = tricl_fft_lut_acquire(logn);
+    b.x = malloc(2 * b.n * sizeof(real));
+    b.spec = malloc(b.n * sizeof(real));
+    b.y = malloc(2 * b.n * sizeof(real));
+    b.out = malloc(b.n * sizeof(real));
+    ok = b.lut && b.x && b.spec && b.y && b.out;
+    for (i = 0; ok && i < 2 * b.n; i++)
+    {
+        b.x[i] = (real)(2.0 * rand() / RAND_MAX - 1);
+    }
+    nlogn = (double)b.n * logn;
+
+    if (!ok)
+    {
+        bench_free(&b);
+        return 0;
+    }
+
+    bench_one("fft", &b, op_fft, check_fft, 2 * b.n, 5 * nlogn, minTime, first);
+    bench_one("r2c", &b, op_r2c, check_r2c, 0, 2.5 * nlogn, minTime, first);
+    // Scaled, so that the round trip gives input back
+    memcpy(b.spec, b.y, b.n * sizeof(real));
+    tricl_fft_r2c_scale(b.spec, logn);
+    bench_one("c2r", &b, op_c2r, check_c2r, b.n, 2.5 * nlogn, minTime, first);
+
+    // Bluestein and chirp-z are for sizes other than powers of 2
+    b.n = 3 << (logn - 2);
+    nlogn = b.n * log((double)b.n) / log(2.);
+    b.bluestein = tricl_fft_bluestein_alloc(b.n);
+    ok = b.bluestein != NULL;
+    if (ok)
+    {
+        bench_one("bluestein_r2c", &b, op_bluestein, check_bluestein, 0, 2.5 * nlogn, minTime, first);
+        tricl_fft_bluestein_free(b.bluestein);
+        b.bluestein = NULL;
+    }
+    b.chirpz = ok ? tricl_fft_chirpz_alloc(b.n, b.n, NULL, NULL, (real)CHIRPZ_ZOOM) : NULL;
+    ok = b.chirpz != NULL;
+    if (ok)
+    {
+        bench_one("chirpz", &b, op_chirpz, check_chirpz, 0, 5 * nlogn, minTime, first);
+    }
+    bench_free(&b);
+    return ok;
+}
+
+
+/**
+*   Write stereo noise as raw PCM, starting from sample skip
+*   @return 0 if failed
+*/
+static int write_noise(const TCHAR * name, const double * noise, size_t count, size_t skip)
+{
+    wav_file_t * wf = WAV_open_write(name, WAV_fmt(ALIGN_HZ, ALIGN_CH, 16, E_PCM_INTEGER), EFILE_RAW);
+    size_t written;
+    if (!wf)
+    {
+        return 0;
+    }
+    written = WAV_write_doubles(wf, noise + skip * ALIGN_CH, count - skip);
+    WAV_close_write(wf);
+    return written == count - skip;
+}
+
+
+/**
+*   Align noise to its copy, shifted by half of the range: time of
+*   ALIGN_create() and ALIGN_align_pair(), as they are called by wd
+*   @return 0 if failed
+*/
+static int bench_align(unsigned long range, int * first)
+{
+    static const TCHAR * name[2] = {_T("wd_bench0.raw"), _T("wd_bench1.raw")};
+    pcm_format_t fmt = WAV_fmt(ALIGN_HZ, ALIGN_CH, 16, E_PCM_INTEGER);
+    size_t i, count = 2 * (size_t)range + ALIGN_LEN;
+    double * noise = malloc(count * ALIGN_CH * sizeof(double));
+    wav_file_t * wf[2] = {NULL, NULL};
+    align_ctx_t * ctx = NULL;
+    double psr = 0, sec = 0;
+    long offset = 0;
+    int ok;
+
+    for (i = 0; noise && i < count * ALIGN_CH; i++)
+    {
+        noise[i] = 0.5 * rand() / RAND_MAX - 0.25;
+    }
+    ok = noise && write_noise(name[0], noise, count, 0) && write_noise(name[1], noise, count, range / 2);
+    free(noise);
+    if (ok)
+    {
+        double t0;
+        wf[0] = WAV_open_read(name[0], &fmt);
+        wf[1] = WAV_open_read(name[1], &fmt);
+        t0 = time_sec();
+        ctx = wf[0] && wf[1] ? ALIGN_create(range, ALIGN_CH, E_ALIGN_COARSE_ENVELOPE, 0) : NULL;
+        if (ctx)
+        {
+            psr = ALIGN_align_pair(ctx, wf[0], wf[1]);
+            sec = time_sec() - t0;
+            offset = (long)(WAV_get_sample_pos(wf[0]) - WAV_get_sample_pos(wf[1]));
+        }
+        ok = ctx != NULL;
+    }
+    ALIGN_free(ctx);
+    for (i = 0; i < 2; i++)
+    {
+        if (wf[i])
+        {
+            WAV_close_read(wf[i]);
+        }
+        _tremove(name[i]);
+    }
+    if (ok)
+    {
+        printf("%s\n    {\"range\": %lu, \"expected\": %lu, \"offset\": %ld, \"psr\": %.3g, \"ms\": %.4g}",
+            *first ? "" : ",", range, range / 2, offset, psr, 1e3 * sec);
+        *first = 0;
+        fflush(stdout);
+    }
+    return ok;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int logMin = 8, logMax = 24, isa = TRICL_ISA_MAX, threads = 0;
+    unsigned long alignMax = 1000000, range;
+    double minTime = 0.05;
+    int i, logn, first = 1, ok = 1;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strncmp(argv[i], "-min", 4))
+        {
+            logMin = atoi(argv[i] + 4);
+        }
+        else if (!strncmp(argv[i], "-max", 4))
+        {
+            logMax = atoi(argv[i] + 4);
+        }
+        else if (!strncmp(argv[i], "-threads", 8))
+        {
+            threads = atoi(argv[i] + 8);
+        }
+        else if (!strncmp(argv[i], "-t", 2))
+        {
+            minTime = atof(argv[i] + 2);
+        }
+        else if (!strncmp(argv[i], "-isa", 4))
+        {
+            isa = atoi(argv[i] + 4);
+        }
+        else if (!strncmp(argv[i], "-align", 6))
+        {
+            alignMax = strtoul(argv[i] + 6, NULL, 10);
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    // Bluestein and chirp-z sizes are 3 * 2^(logn - 2)
+    logMin = MAX(logMin, 3);
+    srand(1);
+    tricl_fft_set_threads(threads);
+
+    printf("{\n  \"real_bytes\": %u,\n  \"isa\": %d,\n  \"threads\": %d,\n  \"fft\": [",
+        (unsigned)sizeof(real), tricl_fft_set_isa(isa), threads);
+    for (logn = logMin; ok && logn <= logMax; logn++)
+    {
+        ok = bench_size(logn, minTime, &first);
+    }
+    printf("\n  ],\n  \"align\": [");
+    first = 1;
+    for (range = ALIGN_RANGE_MIN; ok && range <= alignMax; range *= 10)
+    {
+        ok = bench_align(range, &first);
+    }
+    printf("\n  ],\n  \"ok\": %d\n}\n", ok);
+    return !ok;
+}
+
+#endif //dsp_ffttricl_bench
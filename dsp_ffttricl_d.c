@@ -0,0 +1,7 @@
+/** 18.10.2026 @file
+*   Double precision instance of TRICL FFT: tricl_d_* functions.
+*/
+#undef SIZEOF_REAL
+#define SIZEOF_REAL 8
+#define TRICL_INSTANCE
+#include "dsp_ffttricl.c"
@@ -0,0 +1,7 @@
+/** 18.10.2026 @file
+*   Single precision instance of TRICL FFT: tricl_f_* functions.
+*/
+#undef SIZEOF_REAL
+#define SIZEOF_REAL 4
+#define TRICL_INSTANCE
+#include "dsp_ffttricl.c"
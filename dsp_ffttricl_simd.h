@@ -0,0 +1,125 @@
+/** 18.10.2026 @file
+*   Split-radix butterfly loops of TRICL FFT, written in terms of vector
+*   operations V_*(). Included by dsp_ffttricl.c once per instruction set,
+*   with V_*() set for it and for `real`; do not include directly. V_*() are
+*   undefined at the end.
+*
+*   Complex values stay interleaved (re, im), V_CPX of them per vector, so
+*   the data layout and the output order are the same as of FFT_SRM_W and
+*   IFFT_SRM_W loops.
+*/
+
+/**
+*   FFT_SRM_W over complex elements from..to-1 of the four quarters of DAT
+*/
+static V_TARGET void V_NAME(fft_srm_w)(real * DAT, const real * LUT, unsigned len, unsigned from, unsigned to)
+{
+    real * a = DAT;
+    real * b = DAT + len * 2;
+    real * c = DAT + len * 4;
+    real * d = DAT + len * 6;
+    const real * w = LUT + len * 2;
+    unsigned i;
+
+    // Scalar up to a multiple of V_CPX: vectors and results do not depend
+    // on the range split
+    for (i = 2 * from; i < 2 * to && (i / 2) % V_CPX; i += 2)
+    {
+        FFT_SRM_W(a + i, b + i, c + i, d + i, w + i);
+    }
+    for (; i + 2 * V_CPX <= 2 * to; i += 2 * V_CPX)
+    {
+        V_REG va = V_LOAD(a + i);
+        V_REG vb = V_LOAD(b + i);
+        V_REG vc = V_LOAD(c + i);
+        V_REG vd = V_LOAD(d + i);
+        V_REG vw = V_LOAD(w + i);
+        V_REG wr = V_DUPRE(vw);
+        V_REG wi = V_DUPIM(vw);
+        V_REG t0 = V_SUB(va, vc);
+        V_REG t1 = V_SUB(vb, vd);
+        V_REG t2;
+
+        va = V_ADD(va, vc);
+        vb = V_ADD(vb, vd);
+        t1 = V_SWAP(t1);
+        t2 = V_ADDSUB(t0, t1);                  // t0 + i*t1
+        t0 = V_SUBADD(t0, t1);                  // t0 - i*t1
+        vc = V_CMUL(t2, wr, wi);
+        vd = V_CMULJ(t0, wr, wi);
+
+        V_STORE(a + i, va);
+        V_STORE(b + i, vb);
+        V_STORE(c + i, vc);
+        V_STORE(d + i, vd);
+    }
+    for (; i < 2 * to; i += 2)
+    {
+        FFT_SRM_W(a + i, b + i, c + i, d + i, w + i);
+    }
+}
+
+/**
+*   IFFT_SRM_W over complex elements from..to-1 of the four quarters of DAT
+*/
+static V_TARGET void V_NAME(ifft_srm_w)(real * DAT, const real * LUT, unsigned len, unsigned from, unsigned to)
+{
+    real * a = DAT;
+    real * b = DAT + len * 2;
+    real * c = DAT + len * 4;
+    real * d = DAT + len * 6;
+    const real * w = LUT + len * 2;
+    unsigned i;
+
+    // Scalar up to a multiple of V_CPX: vectors and results do not depend
+    // on the range split
+    for (i = 2 * from; i < 2 * to && (i / 2) % V_CPX; i += 2)
+    {
+        IFFT_SRM_W(a + i, b + i, c + i, d + i, w + i);
+    }
+    for (; i + 2 * V_CPX <= 2 * to; i += 2 * V_CPX)
+    {
+        V_REG va = V_LOAD(a + i);
+        V_REG vb = V_LOAD(b + i);
+        V_REG vc = V_LOAD(c + i);
+        V_REG vd = V_LOAD(d + i);
+        V_REG vw = V_LOAD(w + i);
+        V_REG wr = V_DUPRE(vw);
+        V_REG wi = V_DUPIM(vw);
+        V_REG t0 = V_CMULJ(vc, wr, wi);
+        V_REG t1 = V_CMUL(vd, wr, wi);
+        V_REG s = V_ADD(t0, t1);
+        V_REG u = V_SWAP(V_SUB(t0, t1));
+
+        vc = V_SUB(va, s);
+        va = V_ADD(va, s);
+        vd = V_ADDSUB(vb, u);                   // b + i*(t0 - t1)
+        vb = V_SUBADD(vb, u);                   // b - i*(t0 - t1)
+
+        V_STORE(a + i, va);
+        V_STORE(b + i, vb);
+        V_STORE(c + i, vc);
+        V_STORE(d + i, vd);
+    }
+    for (; i < 2 * to; i += 2)
+    {
+        IFFT_SRM_W(a + i, b + i, c + i, d + i, w + i);
+    }
+}
+
+// Parameters are reset for the next instruction set
+#undef V_NAME
+#undef V_TARGET
+#undef V_CPX
+#undef V_REG
+#undef V_LOAD
+#undef V_STORE
+#undef V_ADD
+#undef V_SUB
+#undef V_SWAP
+#undef V_DUPRE
+#undef V_DUPIM
+#undef V_ADDSUB
+#undef V_SUBADD
+#undef V_CMUL
+#undef V_CMULJ
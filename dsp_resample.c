@@ -0,0 +1,200 @@
+/** 18.10.2026 @file
+*   Streaming windowed-sinc resampler.
+*
+*   Interpolation kernel is Kaiser-windowed sinc, tabulated at RESAMPLE_PHASES
+*   fractional positions. Coefficients for arbitrary fractional position
+*   are obtained by linear interpolation between adjacent table rows.
+*/
+#include "dsp_resample.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RESAMPLE_PHASES     256                 //!< Kernel table resolution
+#define KAISER_BETA         8.0                 //!< Kaiser window shape
+#define CUTOFF              0.97                //!< Passband edge, relative to Nyquist
+#define PI                  3.14159265358979323846
+
+struct resample_t
+{
+    unsigned int            nch;
+    int                     taps;               //!< Kernel length (even)
+    double                  ratio;              //!< Input samples per output sample
+    double                  phase;              //!< Input position of the 1st output sample
+    double                  base;               //!< Input position of in[0] (samples consumed so far)
+    double                  count;              //!< Number of output samples produced
+    double *                kernel;             //!< (RESAMPLE_PHASES + 1) x taps coefficients
+    double *                coef;               //!< Interpolated coefficients for current position
+};
+
+
+/**
+*   Modified Bessel function of the 1st kind, order 0
+*/
+static double bessel_i0(double x)
+{
+    double sum = 1;
+    double term = 1;
+    int k;
+    for (k = 1; k < 50 && term > sum * 1e-17; k++)
+    {
+        term *= (x / (2*k)) * (x / (2*k));
+        sum += term;
+    }
+    return sum;
+}
+
+
+/**
+*   Build table of kernel coefficients. Row p holds coefficients for
+*   fractional position mu = p / RESAMPLE_PHASES, tap k is applied to input
+*   sample (i + k - taps/2 + 1), where i is integer part of the position.
+*/
+static void make_kernel(double * kernel, int taps, double cutoff)
+{
+    int p, k;
+    double half = taps / 2;
+    double norm = 1 / bessel_i0(KAISER_BETA);
+    for (p = 0; p <= RESAMPLE_PHASES; p++)
+    {
+        double mu = (double)p / RESAMPLE_PHASES;
+        double sum = 0;
+        double * row = kernel + p * taps;
+        for (k = 0; k < taps; k++)
+        {
+            double x = k - half + 1 - mu;
+            double w = x / half;
+            double h = cutoff;
+            if (x != 0)
+            {
+                h = sin(PI * cutoff * x) / (PI * x);
+            }
+            w = 1 - w*w;
+            row[k] = w > 0 ? h * bessel_i0(KAISER_BETA * sqrt(w)) * norm : 0;
+            sum += row[k];
+        }
+        // Unity DC gain
+        for (k = 0; k < taps; k++)
+        {
+            row[k] /= sum;
+        }
+    }
+}
+
+
+resample_t * RESAMPLE_alloc(unsigned int nch, double ratio, double phase, int taps)
+{
+    resample_t * h;
+    if (!nch || ratio <= 0)
+    {
+        return NULL;
+    }
+    if (taps <= 0)
+    {
+        taps = RESAMPLE_DEFAULT_TAPS;
+    }
+    taps = (taps + 1) & ~1;
+
+    h = calloc(1, sizeof(resample_t));
+    if (!h)
+    {
+        return NULL;
+    }
+    h->nch = nch;
+    h->taps = taps;
+    h->ratio = ratio;
+    h->phase = phase;
+    h->kernel = malloc((RESAMPLE_PHASES + 1) * taps * sizeof(double));
+    h->coef = malloc(taps * sizeof(double));
+    if (!h->kernel || !h->coef)
+    {
+        RESAMPLE_free(h);
+        return NULL;
+    }
+    // Anti-aliasing for down-sampling
+    make_kernel(h->kernel, taps, ratio > 1 ? CUTOFF / ratio : CUTOFF);
+    return h;
+}
+
+
+void RESAMPLE_free(resample_t * h)
+{
+    if (h)
+    {
+        free(h->kernel);
+        free(h->coef);
+        free(h);
+    }
+}
+
+
+size_t RESAMPLE_process(resample_t * h, const double * in, size_t in_count, size_t * in_used, double * out, size_t out_count)
+{
+    size_t n;
+    size_t used;
+    unsigned int ch;
+    unsigned int nch = h->nch;
+    int k;
+    int taps = h->taps;
+    int half = taps / 2;
+    double t = 0;
+
+    for (n = 0; n < out_count; n++)
+    {
+        double pos, mu;
+        long i, first;
+        const double * row;
+
+        // Position relative to in[0]; computed from counter to avoid error accumulation
+        t = h->phase + h->count * h->ratio - h->base;
+        i = (long)floor(t);
+        first = i - half + 1;
+        if (i + half >= (long)in_count)
+        {
+            break;
+        }
+
+        // Interpolate kernel between adjacent phases
+        pos = (t - i) * RESAMPLE_PHASES;
+        k = (int)pos;
+        mu = pos - k;
+        row = h->kernel + k * taps;
+        for (k = 0; k < taps; k++)
+        {
+            h->coef[k] = row[k] + mu * (row[k + taps] - row[k]);
+        }
+
+        for (ch = 0; ch < nch; ch++)
+        {
+            double acc = 0;
+            k = 0;
+            if (first < 0)
+            {
+                // Samples before the start of stream are zero
+                k = (int)-first;
+            }
+            for (; k < taps; k++)
+            {
+                acc += h->coef[k] * in[(first + k) * nch + ch];
+            }
+            out[n * nch + ch] = acc;
+        }
+        h->count++;
+    }
+
+    // Keep input samples, required for the next output sample
+    t = h->phase + h->count * h->ratio - h->base;
+    used = 0;
+    if (floor(t) - half + 1 > 0)
+    {
+        used = (size_t)(floor(t) - half + 1);
+    }
+    if (used > in_count)
+    {
+        used = in_count;
+    }
+    h->base += used;
+    *in_used = used;
+    return n;
+}
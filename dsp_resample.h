@@ -0,0 +1,74 @@
+/** 18.10.2026 @file
+*   Streaming resampler for interleaved PCM with arbitrary (slowly
+*   varying or fixed) ratio: windowed-sinc polyphase table with linear
+*   interpolation between phases (Farrow-like structure).
+*
+*   Output sample n is interpolated at input position:
+*
+*       t(n) = phase + n * ratio
+*
+*   Example:
+*
+*   resample_t * h = RESAMPLE_alloc(nch, ratio, phase, 0);
+*   while (...)
+*   {
+*       fill += read(buf + fill*nch, ...);
+*       produced = RESAMPLE_process(h, buf, fill, &used, out, out_size);
+*       memmove(buf, buf + used*nch, (fill - used)*nch*sizeof(double));
+*       fill -= used;
+*   }
+*   RESAMPLE_free(h);
+*/
+
+#ifndef dsp_resample_H_INCLUDED
+#define dsp_resample_H_INCLUDED
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  //__cplusplus
+
+// Default interpolation filter length
+#define RESAMPLE_DEFAULT_TAPS 32
+
+typedef struct resample_t resample_t;
+
+/**
+*   Create resampler
+*   @return resampler handle, or NULL if no memory
+*/
+resample_t * RESAMPLE_alloc(
+    unsigned int            nch,                //!< Number of interleaved channels
+    double                  ratio,              //!< Input samples per output sample
+    double                  phase,              //!< Input position of the 1st output sample
+    int                     taps                //!< Interpolation filter length (0 - default)
+    );
+
+/**
+*   Release resampler
+*/
+void RESAMPLE_free(
+    resample_t *            h                   //!< Resampler handle
+    );
+
+/**
+*   Produce up to out_count output samples. Input buffer must start with
+*   samples, not consumed on previous calls. Samples before the start of
+*   stream are assumed to be zero.
+*   @return number of output samples produced
+*/
+size_t RESAMPLE_process(
+    resample_t *            h,                  //!< Resampler handle
+    const double *          in,                 //!< [IN] Interleaved input samples
+    size_t                  in_count,           //!< Number of input samples
+    size_t *                in_used,            //!< [OUT] Number of input samples consumed
+    double *                out,                //!< [OUT] Interleaved output samples
+    size_t                  out_count           //!< Output buffer size, samples
+    );
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif //dsp_resample_H_INCLUDED
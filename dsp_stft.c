@@ -0,0 +1,257 @@
+/** 18.10.2026 @file
+*   Streaming short-time spectra and overlap-save convolution.
+*
+*   Short-time transform keeps the last frame of input in a FIFO and
+*   shifts it by hop after each frame. Convolution transforms pairs of
+*   channels as real and imaginary parts of one complex FFT: filter is
+*   real, so products of the pair spectra with its spectrum do not mix
+*   the channels.
+*/
+#include "dsp_stft.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dsp_ffttricl.h"
+
+#define CONV_SIZE_FACTOR    4                   //!< Min transform size, filter lengths
+#define CONV_LOG_MIN        6                   //!< Min transform size, log2
+#define CONV_LOG_MAX        27                  //!< Max transform size, log2
+#define PI                  3.14159265358979323846
+#define MIN( x, y )         ( (x)<(y)?(x):(y) )
+
+struct stft_t
+{
+    unsigned int            nch;
+    int                     size;               //!< Frame size
+    int                     hop;                //!< Distance of frames
+    int                     fill;               //!< Samples in FIFO
+    double *                fifo;               //!< Interleaved frame, size x nch
+    double *                window;
+    double *                frame;              //!< Windowed channel of the frame
+    double *                spec;               //!< Spectra, nch x (size + 2)
+    tricl_d_fft_real_spectr_t * fft;
+};
+
+struct stft_conv_t
+{
+    unsigned int            nch;
+    int                     logn;               //!< log2 of transform size
+    size_t                  taps;               //!< Filter length
+    size_t                  block;              //!< New samples per transform
+    size_t                  fill;               //!< Samples of the current block
+    const double *          lut;                //!< Shared, see tricl_fft_lut_acquire()
+    double *                filter;             //!< Filter spectrum, scaled by 1/n
+    double *                in;                 //!< Interleaved input: taps - 1 samples of history, then block
+    double *                out;                //!< Interleaved output of the previous block
+    double *                work;               //!< Complex transform of pair of channels
+};
+
+
+stft_t * STFT_alloc(unsigned int nch, int size, int hop, const double * window)
+{
+    stft_t * h;
+    int i;
+    if (!nch || size < 4 || (size & (size - 1)) || hop < 1 || hop > size)
+    {
+        return NULL;
+    }
+    h = calloc(1, sizeof(stft_t));
+    if (!h)
+    {
+        return NULL;
+    }
+    h->nch = nch;
+    h->size = size;
+    h->hop = hop;
+    h->fifo = malloc(size * nch * sizeof(double));
+    h->window = malloc(size * sizeof(double));
+    h->frame = malloc(size * sizeof(double));
+    h->spec = malloc((size + 2) * nch * sizeof(double));
+    h->fft = tricl_d_fft_real_spectr_mem_alloc(size);
+    if (!h->fifo || !h->window || !h->frame || !h->spec || !h->fft)
+    {
+        STFT_free(h);
+        return NULL;
+    }
+    for (i = 0; i < size; i++)
+    {
+        h->window[i] = window ? window[i] : 0.5 - 0.5*cos(2*PI*i/size);
+    }
+    return h;
+}
+
+
+void STFT_free(stft_t * h)
+{
+    if (h)
+    {
+        free(h->fifo);
+        free(h->window);
+        free(h->frame);
+        free(h->spec);
+        tricl_d_fft_real_spectr_free(h->fft);
+        free(h);
+    }
+}
+
+
+int STFT_process(stft_t * h, const double * in, size_t in_count, size_t * in_used)
+{
+    unsigned int c, nch = h->nch;
+    size_t take = MIN(in_count, (size_t)(h->size - h->fill));
+    int i, size = h->size;
+
+    memcpy(h->fifo + h->fill * nch, in, take * nch * sizeof(double));
+    h->fill += (int)take;
+    *in_used = take;
+    if (h->fill < size)
+    {
+        return 0;
+    }
+
+    for (c = 0; c < nch; c++)
+    {
+        for (i = 0; i < size; i++)
+        {
+            h->frame[i] = h->fifo[i * nch + c] * h->window[i];
+        }
+        memcpy(h->spec + c * (size + 2), tricl_d_fft_r2spec(h->fft, h->frame), (size + 2) * sizeof(double));
+    }
+    // Overlap with the next frame
+    memmove(h->fifo, h->fifo + h->hop * nch, (size - h->hop) * nch * sizeof(double));
+    h->fill = size - h->hop;
+    return 1;
+}
+
+
+const double * STFT_spectrum(const stft_t * h, unsigned int ch)
+{
+    return h->spec + ch * (h->size + 2);
+}
+
+
+stft_conv_t * STFT_conv_alloc(unsigned int nch, const double * taps, int count)
+{
+    stft_conv_t * h;
+    size_t i, n;
+    if (!nch || count < 1)
+    {
+        return NULL;
+    }
+    h = calloc(1, sizeof(stft_conv_t));
+    if (!h)
+    {
+        return NULL;
+    }
+    h->nch = nch;
+    h->taps = count;
+    h->logn = CONV_LOG_MIN;
+    while (((size_t)1 << h->logn) < CONV_SIZE_FACTOR * h->taps && h->logn < CONV_LOG_MAX)
+    {
+        h->logn++;
+    }
+    n = (size_t)1 << h->logn;
+    if (n < CONV_SIZE_FACTOR * h->taps)
+    {
+        STFT_conv_free(h);
+        return NULL;
+    }
+    h->block = n - h->taps + 1;
+    h->lut = tricl_d_fft_lut_acquire(h->logn);
+    h->filter = calloc(2 * n, sizeof(double));
+    h->in = calloc(n * nch, sizeof(double));
+    h->out = calloc(h->block * nch, sizeof(double));
+    h->work = malloc(2 * n * sizeof(double));
+    if (!h->lut || !h->filter || !h->in || !h->out || !h->work)
+    {
+        STFT_conv_free(h);
+        return NULL;
+    }
+    // Inverse transform is not normalized
+    for (i = 0; i < h->taps; i++)
+    {
+        h->filter[2*i] = taps[i] / n;
+    }
+    tricl_d_fft_fft(h->filter, h->logn, h->lut);
+    return h;
+}
+
+
+void STFT_conv_free(stft_conv_t * h)
+{
+    if (h)
+    {
+        tricl_d_fft_lut_release(h->lut);
+        free(h->filter);
+        free(h->in);
+        free(h->out);
+        free(h->work);
+        free(h);
+    }
+}
+
+
+size_t STFT_conv_latency(const stft_conv_t * h)
+{
+    return h->block;
+}
+
+
+/**
+*   Filter the block of h->in[] to h->out[]: circular convolution of the
+*   transform size is linear one after taps - 1 samples of history
+*/
+static void conv_block(stft_conv_t * h)
+{
+    unsigned int c, nch = h->nch;
+    size_t i, n = (size_t)1 << h->logn;
+    size_t skip = h->taps - 1;
+    double * z = h->work;
+
+    for (c = 0; c < nch; c += 2)
+    {
+        const double * x = h->in + c;
+        double * y = h->out + c;
+        int pair = c + 1 < nch;
+        for (i = 0; i < n; i++, x += nch)
+        {
+            z[2*i + 0] = x[0];
+            z[2*i + 1] = pair ? x[1] : 0;
+        }
+        tricl_d_fft_fft(z, h->logn, h->lut);
+        tricl_d_fftconv_mulpw(z, h->filter, h->logn);
+        tricl_d_fft_ifft(z, h->logn, h->lut);
+        for (i = 0; i < h->block; i++, y += nch)
+        {
+            y[0] = z[2*(skip + i) + 0];
+            if (pair)
+            {
+                y[1] = z[2*(skip + i) + 1];
+            }
+        }
+    }
+    memmove(h->in, h->in + h->block * nch, skip * nch * sizeof(double));
+}
+
+
+void STFT_conv_process(stft_conv_t * h, const double * in, double * out, size_t count)
+{
+    unsigned int nch = h->nch;
+    while (count > 0)
+    {
+        size_t take = MIN(count, h->block - h->fill);
+        // Input is taken before output is written: out may be in
+        memcpy(h->in + (h->taps - 1 + h->fill) * nch, in, take * nch * sizeof(double));
+        memcpy(out, h->out + h->fill * nch, take * nch * sizeof(double));
+        h->fill += take;
+        in += take * nch;
+        out += take * nch;
+        count -= take;
+        if (h->fill == h->block)
+        {
+            conv_block(h);
+            h->fill = 0;
+        }
+    }
+}
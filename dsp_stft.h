@@ -0,0 +1,124 @@
+/** 18.10.2026 @file
+*   Streaming short-time spectra and block convolution of interleaved PCM
+*   on top of TRICL FFT. Memory is allocated when the handle is made; per
+*   block calls do not allocate, and take input blocks of any size, as
+*   read by WAV_read_doubles().
+*
+*   Short-time spectra: frame k covers input samples k*hop .. k*hop+size-1.
+*
+*   stft_t * h = STFT_alloc(nch, size, hop, NULL);
+*   while ((count = WAV_read_doubles(wf, buf, BLOCK)) > 0)
+*   {
+*       const double * in = buf;
+*       while (STFT_process(h, in, count, &used))
+*       {
+*           in += used*nch;
+*           count -= used;
+*           spectrum = STFT_spectrum(h, ch);        // analyze frame
+*       }
+*   }
+*   STFT_free(h);
+*
+*   Convolution with FIR filter (overlap-save), delayed by STFT_conv_latency():
+*
+*   stft_conv_t * h = STFT_conv_alloc(nch, taps, ntaps);
+*   while ((count = WAV_read_doubles(wf, buf, BLOCK)) > 0)
+*   {
+*       STFT_conv_process(h, buf, buf, count);      // in place
+*   }
+*   STFT_conv_free(h);
+*/
+
+#ifndef dsp_stft_H_INCLUDED
+#define dsp_stft_H_INCLUDED
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  //__cplusplus
+
+typedef struct stft_t stft_t;
+typedef struct stft_conv_t stft_conv_t;
+
+/**
+*   Create short-time transform
+*   @return handle, or NULL if no memory or size is not a power of 2
+*/
+stft_t * STFT_alloc(
+    unsigned int            nch,                //!< Number of interleaved channels
+    int                     size,               //!< Frame size, samples, power of 2, 4 or more
+    int                     hop,                //!< Distance of frames, samples, 1 .. size
+    const double *          window              //!< size window coefficients (NULL - periodic Hann), copied
+    );
+
+/**
+*   Release short-time transform
+*/
+void STFT_free(
+    stft_t *                h                   //!< Handle
+    );
+
+/**
+*   Consume input up to the end of the next frame and transform it.
+*   @return 1 if frame spectra are ready, 0 if all input is consumed
+*   without completing a frame
+*/
+int STFT_process(
+    stft_t *                h,                  //!< Handle
+    const double *          in,                 //!< [IN] Interleaved input samples
+    size_t                  in_count,           //!< Number of input samples
+    size_t *                in_used             //!< [OUT] Number of input samples consumed
+    );
+
+/**
+*   Spectrum of the last frame of the channel, valid until the next
+*   STFT_process(): size/2 + 1 complex values (re, im), DC to Nyquist,
+*   as tricl_fft_r2spec() gives.
+*/
+const double * STFT_spectrum(
+    const stft_t *          h,                  //!< Handle
+    unsigned int            ch                  //!< Channel
+    );
+
+/**
+*   Create FIR filter, applied by overlap-save blocks of power of 2
+*   transforms, 4 or more times longer than the filter
+*   @return handle, or NULL if no memory
+*/
+stft_conv_t * STFT_conv_alloc(
+    unsigned int            nch,                //!< Number of interleaved channels
+    const double *          taps,               //!< Filter coefficients, copied
+    int                     count               //!< Number of coefficients
+    );
+
+/**
+*   Release FIR filter
+*/
+void STFT_conv_free(
+    stft_conv_t *           h                   //!< Handle
+    );
+
+/**
+*   Filter delay, added by block processing, samples
+*/
+size_t STFT_conv_latency(
+    const stft_conv_t *     h                   //!< Handle
+    );
+
+/**
+*   Filter samples: out[n] = sum(taps[k] * in[n - k - latency]). Samples
+*   before the start of stream are zero. out may be in.
+*/
+void STFT_conv_process(
+    stft_conv_t *           h,                  //!< Handle
+    const double *          in,                 //!< [IN] Interleaved input samples
+    double *                out,                //!< [OUT] Interleaved output samples
+    size_t                  count               //!< Number of samples
+    );
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif //dsp_stft_H_INCLUDED
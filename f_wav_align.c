@@ -1,5 +1,7 @@
 /** 18.12.2011 @file
 *   Find "best match" offset between two PCM files, using FFT for fast convolution.
+*   All state is kept in align_ctx_t: separate contexts may be used from
+*   different threads.
 */
 #include "f_wav_align.h"
 
@@ -10,224 +12,578 @@
 
 #include <stdlib.h>
 #include "dsp_ffttricl.h"
+#include "dsp_resample.h"
+#include "f_wav_landmark.h"
 
-typedef real ccf_t;
-
-static ccf_t        * g_fft_twid;
-static ccf_t        * g_fft_input[2];
-static double       * g_input[2];
-static int          g_fft_size;
-static unsigned int g_log_fft_size;
-static int          g_max_offset;
-static int          g_max_fft_size;
+typedef float ccf_t;                    // Correlation is single precision; sub-sample refinement is double
 
+/**
+*   Alignment context: work buffers and search parameters. Twiddle tables
+*   are shared through tricl_f_fft_lut_acquire().
+*/
+struct align_ctx_t
+{
+    const ccf_t *           fft_twid;           //!< Shared twiddle table, for power of 2 windows up to buf_size
+    tricl_f_fft_mixed_t *   mixed;              //!< Mixed-radix transform of the last window size used
+    int                     mixed_size;         //!< Its size
+    ccf_t *                 fft_input[2];       //!< FFT buffers
+    float *                 input[2];           //!< Signal windows, single precision staging
+    double *                energy;             //!< Prefix energy / temporary buffer, buf_size + 1
+    int                     fft_size;           //!< Direct search window, interleaved samples
+    int                     max_offset;         //!< Search range, samples
+    int                     fine_offset;        //!< Fine stage search range, samples
+    size_t                  decim;              //!< Coarse stage decimation (1: direct search)
+    align_coarse_e          coarse;             //!< Coarse stage method
+    int                     buf_size;           //!< Buffers size, interleaved samples
+    int                     size_max;           //!< Buffers size limit by memory cap, interleaved samples
+};
 
 #define MIN_FFT_SIZE_LOG    10
-#define MAX_FFT_SIZE_LOG    24
+#define DIRECT_FFT_SIZE_LOG 20                  // Larger search windows are aligned coarse-to-fine (default memory cap)
+#define MEMORY_SIZE_LOG_MIN 16                  // Memory cap: min buffers size
+#define MEMORY_SIZE_LOG_MAX 28                  // Memory cap: max buffers size
+#define BYTES_PER_ELEMENT   (2*sizeof(float) + 3*sizeof(ccf_t) + sizeof(double))    // Inputs, FFT buffers, twiddles, energy: 28 bytes
+#define COARSE_SIZE_LOG     18                  // Coarse stage: envelope window, decimated samples
+#define FINE_RANGE_DECIM    4                   // Fine stage: search range, decimation periods
+#define FINE_TRIES          4                   // Fine stage: max windows, tried over coarse match
+#define REFINE_LEN_MIN      256                 // Sub-sample refinement: min window, samples
+#define REFINE_LEN_MAX      16384               // Sub-sample refinement: max window, samples
+#define REFINE_ITERATIONS   24                  // Sub-sample refinement: search steps
+#define PSR_EXCLUDE         8                   // Match confidence: main lobe half-width, samples
+#define PSR_FLOOR           1e-4                // Match confidence: residual floor (-40 dB)
+#define SCAN_WINDOWS        8                   // Window selection: scanned prefix, windows
+#define SCAN_SUBBLOCKS      16                  // Window selection: energy blocks per window
+#define SCAN_FLOOR          1e-10               // Window selection: energy floor (-100 dB)
+#define ESCALATE_STEPS      2                   // Low confidence: max window doublings
+#define CONFIRM_SIZE_LOG    16                  // Coarse-to-fine: match confidence window, interleaved samples
+#define MIXED_SIZE_MAX      0.75                // Mixed-radix window: max size relative to power of 2 window (R = 3, 5, 9)
 #define FREE(x)             if (x) {free(x); x = NULL;}
 #define SQR(x)              ((x)*(x))
 #define MAX( x, y )         ( (x)>(y)?(x):(y) )
 #define MIN( x, y )         ( (x)<(y)?(x):(y) )
 
-int ALIGN_init (unsigned int maxOffset, unsigned int maxCh)
+/**
+*   @return log2 of smallest power of 2, not less than size
+*/
+static unsigned int log2_ceil(size_t size)
+{
+    unsigned int n = 0;
+    while (((size_t)1 << n) < size)
+    {
+        n++;
+    }
+    return n;
+}
+
+
+/**
+*   Mixed-radix transform is about 1.25 times slower per n*log(n), so it
+*   is used only if much shorter than power of 2 one: R*2^k, R = 3, 5, 9
+*   @return smallest FFT window, not less than size
+*/
+static int fft_size_ceil(size_t size)
+{
+    int pow2, mixed;
+    size = MAX(size, 1 << MIN_FFT_SIZE_LOG);
+    pow2 = 1 << log2_ceil(size);
+    mixed = tricl_f_fft_mixed_size((int)size);
+    return mixed && mixed <= MIXED_SIZE_MAX*pow2 ? mixed : pow2;
+}
+
+
+/**
+*   @return log2 of largest power of 2, not larger than size
+*/
+static unsigned int log2_floor(size_t size)
+{
+    return log2_ceil(size + 1) - 1;
+}
+
+
+align_ctx_t * ALIGN_create (unsigned int maxOffset, unsigned int maxCh, align_coarse_e coarse, size_t memLimit)
 {
     int i;
+    int size;
+    int sizeLog = DIRECT_FFT_SIZE_LOG;
+    int coarseLog;
     int overheadFactor = 8;
-    g_max_offset = maxOffset;
-    g_log_fft_size = MIN_FFT_SIZE_LOG-1;
+    align_ctx_t * ctx = calloc(1, sizeof(align_ctx_t));
+    if (!ctx)
+    {
+        return NULL;
+    }
     if (maxCh > 6) overheadFactor = 4;
     if (maxCh > 12) overheadFactor = 2;
-    do
-    {
-        g_fft_size = 1 << ++g_log_fft_size;
-    } while (g_fft_size < (int)(overheadFactor*g_max_offset*maxCh) && 
-             g_log_fft_size < MAX_FFT_SIZE_LOG);
+    ctx->max_offset = maxOffset;
+    ctx->fine_offset = maxOffset;
+    ctx->decim = 1;
+    ctx->coarse = coarse;
 
-    if (g_fft_size > g_max_fft_size)
+    // Largest buffers, which fit memory cap
+    if (memLimit)
     {
-        ALIGN_close();
-        g_max_fft_size = g_fft_size;
-
-        g_fft_twid = malloc(sizeof(ccf_t) * g_fft_size);
-        for (i = 0; i < 2; i ++)
+        for (sizeLog = MEMORY_SIZE_LOG_MIN; sizeLog < MEMORY_SIZE_LOG_MAX; sizeLog++)
         {
-            g_input[i]    = malloc(sizeof(double) * g_fft_size);
-            g_fft_input[i] = malloc(sizeof(ccf_t)  * g_fft_size);
-            if (!g_input[i] || !g_fft_input[i] || !g_fft_twid)
+            if (((size_t)2 << sizeLog) * BYTES_PER_ELEMENT > memLimit)
             {
-                ALIGN_close();
-                return 0;
+                break;
             }
         }
-        tricl_fft_makelut(g_fft_twid, g_log_fft_size);
     }
-    return 1;
+    coarseLog = MIN(COARSE_SIZE_LOG, sizeLog);
+    ctx->size_max = 1 << sizeLog;
+
+    // Window, required for direct search, is too large: find offset on
+    // decimated envelope first, then refine at full rate with small window
+    if ((double)overheadFactor*maxOffset*maxCh > ctx->size_max)
+    {
+        ctx->decim = (maxOffset + (1 << coarseLog)/4 - 3) / ((1 << coarseLog)/4 - 2);
+        ctx->decim = MAX(ctx->decim, 2);
+        ctx->fine_offset = (int)ctx->decim * FINE_RANGE_DECIM;
+        if (coarse == E_ALIGN_COARSE_LANDMARKS)
+        {
+            // Landmark offset is accurate to about a hop
+            ctx->fine_offset = MAX(ctx->fine_offset, 2 * LANDMARK_HOP);
+        }
+    }
+    ctx->fft_size = fft_size_ceil((size_t)overheadFactor*ctx->fine_offset*maxCh);
+    ctx->fft_size = MIN(ctx->fft_size, ctx->size_max);
+    size = ctx->decim > 1 ? MAX(ctx->fft_size, 1 << coarseLog) : ctx->fft_size;
+    ctx->buf_size = size;
+
+    ctx->fft_twid = tricl_f_fft_lut_acquire(log2_floor(size));
+    ctx->energy   = malloc(sizeof(double) * (size + 1));
+    for (i = 0; i < 2; i ++)
+    {
+        ctx->input[i]     = malloc(sizeof(float)  * size);
+        ctx->fft_input[i] = malloc(sizeof(ccf_t)  * size);
+        if (!ctx->input[i] || !ctx->fft_input[i] || !ctx->fft_twid || !ctx->energy)
+        {
+            ALIGN_free(ctx);
+            return NULL;
+        }
+    }
+    return ctx;
 }
 
 
-void ALIGN_close (void)
+void ALIGN_free (align_ctx_t * ctx)
 {
     int i;
+    if (!ctx)
+    {
+        return;
+    }
     for (i = 0; i < 2; i ++)
     {
-        FREE(g_input[i]);
-        FREE(g_fft_input[i]);
+        FREE(ctx->input[i]);
+        FREE(ctx->fft_input[i]);
     }
-    FREE(g_fft_twid);
-    g_max_fft_size = 0;
+    tricl_f_fft_lut_release(ctx->fft_twid);
+    tricl_f_fft_mixed_free(ctx->mixed);
+    FREE(ctx->energy);
+    free(ctx);
 }
 
 
-static int bestMatch(const double * p0, size_t len0, const double * p1, double * pdelta, int ch)
+/**
+*   Make mixed-radix transform for window of size interleaved samples,
+*   if it is not a power of 2
+*   @return 0 if no memory
+*/
+static int prepare_mixed(align_ctx_t * ctx, int size)
+{
+    if (!(size & (size - 1)) || size == ctx->mixed_size)
+    {
+        return 1;
+    }
+    tricl_f_fft_mixed_free(ctx->mixed);
+    ctx->mixed = tricl_f_fft_mixed_alloc(size);
+    ctx->mixed_size = ctx->mixed ? size : 0;
+    return ctx->mixed != NULL;
+}
+
+/**
+*   Best match lag by min SSD over lags from -lo to +hi, given circular
+*   correlation ccf (scaled by ccfScale) of p0 with p1 part of seg samples,
+*   matching p0 part from lo at zero lag, see bestMatch(). n is log2 of
+*   transform size.
+*/
+static long min_ssd_lag(align_ctx_t * ctx, const ccf_t * ccf, double ccfScale, const float * p0, size_t len0, const float * p1, size_t seg, size_t lo, size_t hi, int n, int ch, double * pnorm, double * pfrac, double * ppsr)
 {
     size_t i;
-    int n = g_log_fft_size;
-    size_t fftSize;
-    const double * p0orig = p0; 
-    const double * p1orig = p1;
-    size_t max_offset = g_max_offset*ch;
-    size_t len1;
-    double minPwr;
-    size_t minOff = 0;
-    double pwr = 0;
-    double ssd0, ssd1, ssd2;
-    size_t off;
+    double pwr1 = 0;
+    double minSsd, minPwr;
+    long minOff = 0;
+    int dir;
 
-    len1 = len0/2;    // moving window = half of reference; 
-    if (max_offset > len0*3/4)
+    // min SSD (Sum of Squared Difference)
+    // (a-b)^2 = a^2 + b^2 - 2*a*b
+    // ctx->energy[] holds prefix sums of p0^2: p0^2 over any window is a difference
+    ctx->energy[0] = 0;
+    for (i = 0; i < len0; i++) ctx->energy[i + 1] = ctx->energy[i] + SQR(p0[i]);
+    for (i = 0; i < seg; i++) pwr1 += SQR(p1[i]);
+
+#define SSD_AT(lag, pwr) \
+    (pwr = ctx->energy[lo + (lag) + seg] - ctx->energy[lo + (lag)] + pwr1, \
+     pwr - 2*ccf[lo + (lag)]/ccfScale)
+
+    // Zero lag first; then positive lags (1st signal late), then negative.
+    // Local minimum is accepted, if it is better than found so far by more
+    // than rounding error: smaller lags are preferred for equal match.
+    minSsd = SSD_AT(0, minPwr);
+    for (dir = 1; dir >= -1; dir -= 2)
     {
-        max_offset = len0*3/4;
+        double pwr, pwrPrev = minPwr;
+        double ssd0, ssd1, ssd2;
+        long off;
+        ssd0 = ssd1 = ssd2 = SSD_AT(0, pwr);
+        for (off = ch; off <= (long)(dir > 0 ? hi : lo); off += ch)
+        {
+            ssd0 = ssd1;
+            ssd1 = ssd2;
+            ssd2 = SSD_AT(dir*off, pwr);
+            if (off > ch && ssd1 <= ssd0 && ssd1 < ssd2 && 
+                ssd1 + FLT_EPSILON*(16*n + 3)*pwrPrev < minSsd)
+            {
+                minSsd = ssd1;
+                minPwr = pwrPrev;
+                minOff = dir*(off - ch);
+            }
+            pwrPrev = pwr;
+        }
     }
-    if (len1 + max_offset > len0)
+
+    // Parabola through SSD at neighbour lags
+    *pfrac = 0;
+    if (minOff - ch >= -(long)lo && minOff + ch <= (long)hi)
     {
-        len1 = len0 - max_offset;
+        double pwr;
+        double ssdL = SSD_AT(minOff - ch, pwr);
+        double ssdR = SSD_AT(minOff + ch, pwr);
+        double curv = ssdL - 2*minSsd + ssdR;
+        if (curv > 0)
+        {
+            *pfrac = MAX(-0.5, MIN(0.5, (ssdL - ssdR) / (2*curv)));
+        }
     }
 
-    while ((1ul << n >> 1) > len0 + len1)
+    // Peak-to-sidelobe ratio: normalized SSD at the best local minimum
+    // outside the main lobe (the best wrong lag) over that at the best lag.
+    // Main lobe spans while SSD rises from the best lag (wide for low-pass
+    // signals), and PSR_EXCLUDE samples farther. SSD is normalized by power
+    // at each lag, so that loudness changes over lags are not taken as
+    // minima. Residual of near exact match is floored at PSR_FLOOR: periodic
+    // (tonal) signals have close sidelobes, but exact match is still sure
+    if (ppsr)
     {
-        n--;
+        double pwr, ssd, prev = 0, prev2 = 0, side = 0;
+        long off, left = minOff, right = minOff;
+        int found = 0;
+        *ppsr = 0;
+        while (left - ch >= -(long)lo && SSD_AT(left - ch, pwr) > SSD_AT(left, pwr))
+        {
+            left -= ch;
+        }
+        while (right + ch <= (long)hi && SSD_AT(right + ch, pwr) > SSD_AT(right, pwr))
+        {
+            right += ch;
+        }
+        for (off = -(long)lo; off <= (long)hi; off += ch)
+        {
+            ssd = SSD_AT(off, pwr);
+            ssd = pwr > 0 ? ssd / pwr : 1;
+            if (off >= 2*ch - (long)lo && prev <= prev2 && prev <= ssd && (!found || prev < side) &&
+                (off - ch < left - PSR_EXCLUDE*ch || off - ch > right + PSR_EXCLUDE*ch))
+            {
+                side = prev;
+                found = 1;
+            }
+            prev2 = prev;
+            prev = ssd;
+        }
+        if (found)
+        {
+            *ppsr = side / MAX(minPwr > 0 ? minSsd / minPwr : 1, PSR_FLOOR);
+        }
     }
+#undef SSD_AT
+
+    // SSD at best offset, normalized to the signal power: 0 for exact match, ~1 for uncorrelated signals
+    *pnorm = minPwr > 0 ? MAX(minSsd, 0) / minPwr : 1;
+    return minOff;
+}
 
-    fftSize = (size_t)1 << n;
-    while (len0 + len1 > fftSize)
+
+/**
+*   FFT window for len interleaved samples: power of 2 with pow2 flag,
+*   else mixed-radix, if shorter. If there is no memory for mixed-radix
+*   transform, shorter power of 2 window is used, and len is cut to it.
+*   @return window size
+*/
+static size_t fft_window(align_ctx_t * ctx, size_t * len, int pow2)
+{
+    size_t fftSize = pow2 ? (size_t)1 << MAX(MIN_FFT_SIZE_LOG, log2_ceil(*len)) : (size_t)fft_size_ceil(*len);
+    if (!pow2 && !prepare_mixed(ctx, (int)fftSize))
     {
-        len0 /= 2;
-        len1 /= 2;
+        fftSize = (size_t)1 << log2_floor(fftSize);
+        *len = MIN(*len, fftSize);
     }
+    return fftSize;
+}
 
-    //
-    // |<=============p0===============>|
-    // |<---max ofs---->|
-    //                  |<=====p1======>|
-    // avoid tails
-    assert(max_offset + len1 <= len0);
-    
 
-    // |<------------------------fftSize----------------...>|
-    // |<=============p0===============>|
-    //                                  |<=====p1======>|
-    // avoid aliasing: 
-    assert(len0 + len1 <= fftSize);
-    
+/**
+*   Correlate p1 part of seg samples from lo with p0 part of lo + seg + hi
+*   samples by FFT window of fftSize, and find best match lag from -lo to
+*   +hi by min SSD, see min_ssd_lag().
+*   @return lag (interleaved samples), > 0 if 1st signal is late
+*/
+static long match_lags(align_ctx_t * ctx, const float * p0, const float * p1, size_t lo, size_t hi, size_t seg, size_t fftSize, int ch, double * pnorm, double * pfrac, double * ppsr)
+{
+    size_t i;
+    size_t len0 = lo + seg + hi;
+    int n = log2_ceil(fftSize);
+    double ccfScale = 1;
 
-    // Copy input data to FFT array with shuffle for tricl FFT
-    for (i = 0; i < fftSize/2; i++) g_fft_input[0][i*2]   = (real)*p0++;
-    for (i = 0; i < fftSize/2; i++) g_fft_input[0][i*2+1] = (real)*p0++;
+    p1 += lo;
+    assert(len0 <= fftSize && fftSize <= (size_t)ctx->buf_size);
 
-    // Take only half of second signal (leave room for circular convolution)
-    for (i = 0; i < fftSize; i++) g_fft_input[1][i] = 0;
-    for (i = 0; i < MIN(len1, fftSize/2); i++)   g_fft_input[1][i*2]   = (real)*p1++;
-    if (len1>fftSize/2)
+    // Circular correlation, natural order: ctx->fft_input[1][lag] for lag >= 0
+    if (fftSize != (size_t)1 << n)
+    {
+        // Mixed-radix window: output is in natural order. Time domain
+        // input is staged in ctx->energy[]
+        ccf_t * x = (ccf_t *)ctx->energy;
+        for (i = 0; i < fftSize; i++) x[i] = i < len0 ? (ccf_t)p0[i] : 0;
+        tricl_f_fft_mixed_r2c(ctx->mixed, x, ctx->fft_input[0]);
+        for (i = 0; i < fftSize; i++) x[i] = i < seg ? (ccf_t)p1[i] : 0;
+        tricl_f_fft_mixed_r2c(ctx->mixed, x, ctx->fft_input[1]);
+        tricl_f_fft_mixed_mulpr_conj(ctx->mixed, ctx->fft_input[0], ctx->fft_input[1]);
+        tricl_f_fft_mixed_c2r(ctx->mixed, ctx->fft_input[0], ctx->fft_input[1]);
+        ccfScale = (double)fftSize;
+    }
+    else
     {
-        for (i = 0; i < MIN(len1-fftSize/2, fftSize/2); i++)   g_fft_input[1][i*2+1] = (real)*p1++;
+        tricl_f_fft_xcorr(p0, (int)len0, p1, (int)seg, ctx->fft_input[1], ctx->fft_input[0], n, ctx->fft_twid);
     }
 
-    // Circular convolution using tricl FFT. Input and output are shuffled.
-    tricl_fft_r2c(g_fft_input[0], n, g_fft_twid);
-    tricl_fft_r2c(g_fft_input[1], n, g_fft_twid);
-    tricl_fftconv_mulpr_conj(g_fft_input[0], g_fft_input[1], n);
-    g_fft_input[0][0]/=2;
-    g_fft_input[0][1]/=2;
-    tricl_fft_c2r(g_fft_input[0], n, g_fft_twid);
+    return min_ssd_lag(ctx, ctx->fft_input[1], ccfScale, p0, len0, p1, seg, lo, hi, n, ch, pnorm, pfrac, ppsr);
+}
 
-    // Unshuffle output
-    for (i = 0; i < fftSize/2; i++) g_fft_input[1][i]           = g_fft_input[0][i*2  ], 
-                                    g_fft_input[1][i+fftSize/2] = g_fft_input[0][i*2+1];
 
-    p0 = p0orig;
-    p1 = p1orig;
+/**
+*   Find best match lag from 0 to +max_offset: head of 2nd signal is
+*   correlated with the 1st one, so that the range may be up to 3/4 of it:
+*
+*   |<=============p0==============>|
+*   |<-max ofs->|
+*   |<==p1 head==>|
+*
+*   @return lag (interleaved samples)
+*/
+static long match_forward(align_ctx_t * ctx, const float * p0, size_t len0, const float * p1, size_t len1, size_t max_offset, double * pnorm, double * pfrac, double * ppsr, size_t pseg[2], int ch, int pow2)
+{
+    size_t fftSize, seg, used;
 
-    // min SSD (Sum of Squared Difference)
-    // (a-b)^2 = a^2 + b^2 - 2*a*b
-    // a^2 + b^2 == pwr
-    for (i = 0; i < len1; i++) pwr += SQR(p0[i]) + SQR(p1[i]);
-    minPwr = pwr;
+    max_offset = MIN(max_offset, len0*3/4 / ch * ch);
+    seg = MIN(MIN(len0/2 / ch * ch, len0 - max_offset), len1);
+    used = max_offset + seg;
+    fftSize = fft_window(ctx, &used, pow2);
+    if (used < max_offset + seg)
+    {
+        max_offset = MIN(max_offset, used*3/4 / ch * ch);
+        seg = MIN(seg, (used - max_offset) / ch * ch);
+    }
+    pseg[0] = 0;
+    pseg[1] = seg;
+    return match_lags(ctx, p0, p1, 0, max_offset, seg, fftSize, ch, pnorm, pfrac, ppsr);
+}
 
-    ssd0 = ssd1 = ssd2 = pwr;
-    for (off = 0; off < max_offset+ch; off++, p0++)
+
+/**
+*   Find best match lag between two interleaved signals: p0[n + lag] ~ p1[n].
+*
+*   Middle part of 2nd signal is correlated with the whole 1st signal, so
+*   that single circular cross-correlation (one forward FFT per signal and
+*   one inverse) covers both lag directions with equal overlap:
+*
+*   |<==================p0==================>|
+*   |<-max ofs->|<========seg=======>|<-max ofs->|
+*   |           |<====p1 middle====> |
+*
+*   Lag -max_offset is at the beginning of correlation, +max_offset at the end.
+*   Since seg + 2*max_offset <= fftSize, these lags are free of aliasing.
+*   If the range is too large for the shorter signal (e.g. a clip inside
+*   a longer reference), each direction is searched by match_forward(),
+*   and the one with smaller normalized SSD is taken.
+*   Start and length of matched part of the 2nd signal (interleaved samples)
+*   returned in pseg[].
+*   Sub-sample correction to the lag, found by parabolic interpolation of
+*   SSD around the minimum, returned in *pfrac (samples, within +-0.5).
+*   Match confidence, peak-to-sidelobe ratio of SSD (see min_ssd_lag()),
+*   returned in *ppsr, if not NULL. With pow2 flag (coarse stage envelopes), window
+*   is a power of 2.
+*   @return lag (interleaved samples), > 0 if 1st signal is late
+*/
+static long bestMatch(align_ctx_t * ctx, const float * p0, size_t len0, const float * p1, size_t len1, size_t max_offset, size_t len_max, double * pnorm, double * pfrac, double * ppsr, size_t pseg[2], int ch, int pow2)
+{
+    size_t len, fftSize;
+    size_t segBack[2];
+    long lag, back;
+    double norm, frac, psr;
+
+    // Segment of 2*max_offset (len_max = 4*max_offset) is enough to find
+    // the match, and is short enough to keep lag smearing by clock drift small.
+    // Overlap is at least 1/4 of the shorter signal
+    max_offset *= ch;
+    len = MIN(MIN(len0, len1), len_max);
+    fftSize = fft_window(ctx, &len, pow2);
+    if (max_offset <= len*3/8)
     {
-        if ((unsigned)off % ch == 0)
+        pseg[0] = max_offset;
+        pseg[1] = len - 2*max_offset;
+        return match_lags(ctx, p0, p1, max_offset, max_offset, pseg[1], fftSize, ch, pnorm, pfrac, ppsr);
+    }
+
+    // Each direction, with roles of signals swapped for negative lags.
+    // Matched part of the 2nd signal starts at the lag then
+    len0 = MIN(len0, len_max);
+    len1 = MIN(len1, len_max);
+    lag = match_forward(ctx, p0, len0, p1, len1, max_offset, pnorm, pfrac, ppsr, pseg, ch, pow2);
+    back = match_forward(ctx, p1, len1, p0, len0, max_offset, &norm, &frac, ppsr ? &psr : NULL, segBack, ch, pow2);
+    if (norm < *pnorm)
+    {
+        lag = -back;
+        *pnorm = norm;
+        *pfrac = -frac;
+        if (ppsr)
         {
-            double errLinf = FLT_EPSILON*(16*n + 3)*pwr;
-            double delta = pwr - 2*g_fft_input[1][off]/(fftSize/2);
-            ssd0 = ssd1;
-            ssd1 = ssd2;
-            ssd2 = delta;
-#if 0
-            // Reference convolution
-            {
-                double ref_pwr=0;
-                double ref_dif=0;
-                double ref=0;
-                for(i=0;i<len1;i++)
-                { 
-                    ref +=SQR (p0[i]-p1[i]);
-                    ref_pwr +=SQR (p0[i])+SQR(p1[i]);
-                    ref_dif +=p0[i]*p1[i];
-                }
-
-                printf("%5d \t%f \t%f  %f %f \t%f\t%f\t%f\n",off,ssd2,ref,pwr,-2*g_fft_input[1][off]/(fftSize/2), ref_pwr-2*ref_dif, ref_pwr, -2*ref_dif);
-            }
-#endif
+            *ppsr = psr;
+        }
+        pseg[0] = back;
+        pseg[1] = segBack[1];
+    }
+    return lag;
+}
 
-            if (!off)
-            {
-                minPwr = ssd2;
-            }
-            else if (ssd1 <= ssd0 && ssd1 < ssd2 && ssd1 + errLinf < minPwr)
-            {
-                minPwr = ssd1;
-                minOff = off-ch;
-            }
+
+/**
+*   Sum of squared difference between p0 and p1, delayed by fractional offset
+*/
+static double shifted_ssd(const float * p0, const double * p1, size_t len1, size_t start, size_t len, unsigned int ch, double offset, double * tmp)
+{
+    size_t i, used;
+    double ssd = 0;
+    resample_t * h = RESAMPLE_alloc(ch, 1.0, start - offset, 0);
+    if (!h)
+    {
+        return 0;
+    }
+    len = RESAMPLE_process(h, p1, len1, &used, tmp, len);
+    RESAMPLE_free(h);
+    p0 += start * ch;
+    for (i = 0; i < len * ch; i++)
+    {
+        ssd += SQR(p0[i] - tmp[i]);
+    }
+    return ssd;
+}
+
+
+/**
+*   Refine integer offset between signals (p0[n + offset] ~ p1[n]) to 
+*   sub-sample precision, using golden section search of minimal SSD
+*   with windowed-sinc interpolation of the second signal, starting not
+*   earlier than position from of the second signal. Search interval is
+*   +-1 sample around initial guess. Position in the second signal, where
+*   refined offset measured, returned in *at.
+*   @return fractional correction to offset, samples (guess, if window is too short)
+*/
+static double refine_offset(const float * p0, size_t len0, const float * p1, size_t len1, unsigned int ch, long offset, double guess, size_t from, double * at)
+{
+    const double golden = 0.38196601125010515;
+    size_t margin = RESAMPLE_DEFAULT_TAPS;
+    size_t start = MAX((long)from + offset, 0) + margin;
+    size_t len, from1, len1s;
+    double a = guess - 1, b = guess + 1, x, y, fx, fy;
+    double * tmp;
+    double * src;
+    int i;
+
+    if (len0 < start + margin || (long)len1 < (long)start - offset + 2*(long)margin)
+    {
+        return guess;
+    }
+    len = MIN(len0 - start, len1 - (start - offset) - 2*margin);
+    len = MIN(len, REFINE_LEN_MAX);
+    if (len < REFINE_LEN_MIN)
+    {
+        return guess;
+    }
+    // Offset may vary over the window (clock drift): report position of the window center
+    *at = start - offset + len / 2.;
+
+    // Interpolator input: double copy of the 2nd signal part only
+    from1 = start - offset - margin;
+    len1s = len + 3*margin;
+    tmp = malloc((len + len1s) * ch * sizeof(double));
+    if (!tmp)
+    {
+        return guess;
+    }
+    src = tmp + len * ch;
+    for (i = 0; i < (int)(len1s * ch); i++)
+    {
+        src[i] = p1[from1 * ch + i];
+    }
+    offset += (long)from1;
+
+    x = a + golden * (b - a);
+    y = b - golden * (b - a);
+    fx = shifted_ssd(p0, src, len1s, start, len, ch, offset + x, tmp);
+    fy = shifted_ssd(p0, src, len1s, start, len, ch, offset + y, tmp);
+    for (i = 0; i < REFINE_ITERATIONS; i++)
+    {
+        if (fx < fy)
+        {
+            b = y;
+            y = x;
+            fy = fx;
+            x = a + golden * (b - a);
+            fx = shifted_ssd(p0, src, len1s, start, len, ch, offset + x, tmp);
+        }
+        else
+        {
+            a = x;
+            x = y;
+            fx = fy;
+            y = b - golden * (b - a);
+            fy = shifted_ssd(p0, src, len1s, start, len, ch, offset + y, tmp);
         }
-        pwr -= SQR(p0[0]);
-        pwr += SQR(p0[len1]);
     }
-    *pdelta = minPwr;
-    return (int)minOff;
+    free(tmp);
+    return (a + b) / 2;
 }
 
 
 /**
-*   Align two WAV files, by moving current file read position.
+*   Read window of smpNeed samples of both WAV files from current read
+*   positions to ctx->input[], skipping common leading silence. File
+*   positions are restored.
+*   @return number of skipped samples
 */
-void ALIGN_align_pair (wav_file_t * wf0, wav_file_t * wf1)
+static size_t read_window(align_ctx_t * ctx, wav_file_t * wf[2], size_t samples[2], size_t smpNeed)
 {
     int i;
-    unsigned long offset;
-    size_t samples[2] = {0,};
-    double w0,w1;
-    int offs0,offs1;
-    size_t smpNeed = g_fft_size / wf0->fmt.ch;
     size_t smpZero = 0;
-    long initialPos[2];
-    wav_file_t * wf[2];
-    wf[0] = wf0;
-    wf[1] = wf1;
+    size_t skipped = 0;
+    wavpos_t initialPos[2];
 
     for (i = 0; i < 2; i++)
     {
-        initialPos[i] = ftell(wf[i]->file);
+        initialPos[i] = WAV_get_file_pos(wf[i]);
+        samples[i] = 0;
     }
 
     do
@@ -237,50 +593,877 @@ void ALIGN_align_pair (wav_file_t * wf0, wav_file_t * wf1)
         {
             size_t j;
             samples[i] -= smpZero;
-            memmove(g_input[i], g_input[i] + smpZero * wf[i]->fmt.ch, samples[i] * wf[i]->fmt.ch * sizeof(g_input[i][0]));
-            samples[i] += WAV_read_doubles(wf[i], g_input[i] + samples[i] * wf[i]->fmt.ch, smpNeed - samples[i]);
+            memmove(ctx->input[i], ctx->input[i] + smpZero * wf[i]->fmt.ch, samples[i] * wf[i]->fmt.ch * sizeof(ctx->input[i][0]));
+            samples[i] += WAV_read_floats(wf[i], ctx->input[i] + samples[i] * wf[i]->fmt.ch, smpNeed - samples[i]);
 
             // clear tail incomplete sample (required only for odd channels) 
-            for (j = samples[i] * wf[i]->fmt.ch; j < (unsigned)g_fft_size; j++)
+            for (j = samples[i] * wf[i]->fmt.ch; j < smpNeed * wf[i]->fmt.ch; j++)
             {
-                g_input[i][j] = 0;
+                ctx->input[i][j] = 0;
             }
-            for (j = 0; j < samples[i] * wf[i]->fmt.ch && !g_input[i][j]; j++) 
+            for (j = 0; j < samples[i] * wf[i]->fmt.ch && !ctx->input[i][j]; j++) 
             {
             }
-            smpZerox[i] = j / wf0->fmt.ch;
+            smpZerox[i] = j / wf[0]->fmt.ch;
         }
         smpZero = MIN(smpZerox[0], smpZerox[1]);
+        skipped += smpZero;
     } while (smpZero);
 
     // Restore WAV file position
     for (i = 0; i < 2; i++)
     {
-        fseek(wf[i]->file, initialPos[i], SEEK_SET);
+        WAV_set_file_pos(wf[i], initialPos[i]);
     }
 
-    if (!samples[0] || !samples[1])
+    return skipped;
+}
+
+
+/**
+*   Grow work buffers to size interleaved samples
+*   @return 0 if no memory (buffers are kept)
+*/
+static int grow_buffers(align_ctx_t * ctx, int size)
+{
+    int i;
+    double * energy;
+    const ccf_t * twid;
+
+    // On failure buffers are kept, and buf_size is not changed: reallocated
+    // buffers are larger, and the old ones are valid for the old size
+    energy = realloc(ctx->energy, sizeof(double) * (size + 1));
+    if (!energy)
     {
-        // No non-zero samples: do not change position
-        return;
-    }   
+        return 0;
+    }
+    ctx->energy = energy;
+    for (i = 0; i < 2; i++)
+    {
+        float * input = realloc(ctx->input[i], sizeof(float) * size);
+        ccf_t * fftInput;
+        if (!input)
+        {
+            return 0;
+        }
+        ctx->input[i] = input;
+        fftInput = realloc(ctx->fft_input[i], sizeof(ccf_t) * size);
+        if (!fftInput)
+        {
+            return 0;
+        }
+        ctx->fft_input[i] = fftInput;
+    }
+    twid = tricl_f_fft_lut_acquire(log2_floor(size));
+    if (!twid)
+    {
+        return 0;
+    }
+    tricl_f_fft_lut_release(ctx->fft_twid);
+    ctx->fft_twid = twid;
+    ctx->buf_size = size;
+    return 1;
+}
+
+
+/**
+*   Select the most informative window of both WAV files within
+*   SCAN_WINDOWS windows from current read positions: window with maximal
+*   geometric mean of sub-block energies, so that silence, fade-in and
+*   isolated clicks are avoided. Windows are tried with half-window step.
+*   Both files are moved to the start of selected window.
+*   @return number of samples skipped
+*/
+static size_t select_window(align_ctx_t * ctx, wav_file_t * wf[2], size_t window)
+{
+    int i;
+    size_t j, k, count = SCAN_WINDOWS * SCAN_SUBBLOCKS;
+    size_t sub = MAX(window / SCAN_SUBBLOCKS, 1);
+    size_t best = 0, shift;
+    wavpos_t initialPos[2];
+    double logEnergy[SCAN_WINDOWS * SCAN_SUBBLOCKS];
+    double bestScore = 0;
+
+    for (j = 0; j < count; j++)
+    {
+        logEnergy[j] = 0;
+    }
+    for (i = 0; i < 2; i++)
+    {
+        initialPos[i] = WAV_get_file_pos(wf[i]);
+        for (j = 0; j < count; j++)
+        {
+            double e = 0;
+            size_t n, got = WAV_read_doubles(wf[i], ctx->energy, sub);
+            if (got < sub)
+            {
+                break;
+            }
+            for (n = 0; n < sub * wf[i]->fmt.ch; n++)
+            {
+                e += SQR(ctx->energy[n]);
+            }
+            logEnergy[j] += log(e / (sub * wf[i]->fmt.ch) + SCAN_FLOOR);
+        }
+        count = j;
+        WAV_set_file_pos(wf[i], initialPos[i]);
+    }
+
+    for (k = 0; k + SCAN_SUBBLOCKS <= count; k += SCAN_SUBBLOCKS/2)
+    {
+        double score = 0;
+        for (j = k; j < k + SCAN_SUBBLOCKS; j++)
+        {
+            score += logEnergy[j];
+        }
+        if (!k || score > bestScore)
+        {
+            bestScore = score;
+            best = k;
+        }
+    }
+    shift = best * sub;
+    for (i = 0; i < 2; i++)
+    {
+        WAV_set_file_pos(wf[i], initialPos[i] + (wavpos_t)shift * WAV_bytes_per_sample(wf[i]));
+    }
+    return shift;
+}
+
+
+/**
+*   Find best match offset within +-max_offset between two WAV files at
+*   current read positions, using window of given size. With select flag,
+*   window is selected by signal content, and enlarged, while match
+*   confidence is low.
+*   File positions are restored.
+*   @return 0 if any file has no non-zero samples
+*/
+static int match_window(
+    align_ctx_t *           ctx,                //!< Alignment context
+    wav_file_t *            wf[2],              //!< Pair of files
+    int                     window,             //!< Window, interleaved samples
+    size_t                  max_offset,         //!< Search range, samples
+    long *                  offset,             //!< [OUT] Offset, samples: > 0 if 1st file is late, < 0 if 2nd
+    double *                frac,               //!< [OUT] Fractional offset correction, samples (NULL if not needed)
+    double *                at,                 //!< [OUT] Position in the 2nd file, where fractional offset measured
+    double *                residual,           //!< [OUT] Normalized match residual
+    double *                psr,                //!< [OUT] Peak-to-sidelobe ratio of the match (NULL if not needed)
+    int                     select              //!< Select window and escalate its size
+    )
+{
+    int i, step, best = 0, ok = 0;
+    unsigned int ch = wf[0]->fmt.ch;
+    size_t samples[2];
+    size_t seg[2];
+    size_t center;
+    size_t skipped = 0, shift = 0;
+    wavpos_t initialPos[2];
+    double guess, confidence = 0, bestConfidence = 0;
+
+    for (i = 0; i < 2; i++)
+    {
+        initialPos[i] = WAV_get_file_pos(wf[i]);
+    }
+    if (select)
+    {
+        shift = select_window(ctx, wf, window / ch);
+    }
+
+    for (step = 0; ; step++)
+    {
+        int size = window << step;
+        if (size > ctx->buf_size && !grow_buffers(ctx, size))
+        {
+            step--;
+            break;
+        }
+        skipped = read_window(ctx, wf, samples, size / ch);
+        if (!samples[0] || !samples[1])
+        {
+            // No non-zero samples
+            break;
+        }
+        *offset = bestMatch(ctx, ctx->input[0], samples[0]*ch, ctx->input[1], samples[1]*ch, max_offset, (4*max_offset*ch) << step,
+                            residual, &guess, select || psr ? &confidence : NULL, seg, ch, 0);
+        *offset /= (long)ch;
+        ok = 1;
+        if (confidence > bestConfidence)
+        {
+            bestConfidence = confidence;
+            best = step;
+        }
+
+        // Low confidence: enlarge window, while files and memory limit allow
+        if (!select || confidence >= ALIGN_PSR_MIN || step == ESCALATE_STEPS ||
+            size * 2 > ctx->size_max || samples[0] < (size_t)size / ch || samples[1] < (size_t)size / ch)
+        {
+            break;
+        }
+    }
+
+    // Larger window may cover an edit point: back to the most confident one
+    if (ok && step != best)
+    {
+        skipped = read_window(ctx, wf, samples, (window << best) / ch);
+        *offset = bestMatch(ctx, ctx->input[0], samples[0]*ch, ctx->input[1], samples[1]*ch, max_offset, (4*max_offset*ch) << best,
+                            residual, &guess, &confidence, seg, ch, 0);
+        *offset /= (long)ch;
+    }
+
+    if (ok && frac)
+    {
+        // Integer offset is the average over matched part: refine at its center
+        center = (seg[0] + seg[1]/2) / ch;
+        *at = 0;
+        *frac = refine_offset(ctx->input[0], samples[0], ctx->input[1], samples[1], ch, *offset, guess,
+                              center - MIN(center, REFINE_LEN_MAX/2), at);
+        *at += skipped + shift;
+    }
+    if (psr)
+    {
+        *psr = ok ? confidence : 0;
+    }
+    for (i = 0; i < 2; i++)
+    {
+        WAV_set_file_pos(wf[i], initialPos[i]);
+    }
+    return ok;
+}
+
+
+/**
+*   Read envelope of WAV file from current position: mean absolute value
+*   over all channels and decim samples. ctx->energy[] used as read buffer.
+*   @return number of envelope samples
+*/
+static size_t read_envelope(align_ctx_t * ctx, wav_file_t * wf, float * env, size_t count, size_t decim)
+{
+    size_t block = ctx->buf_size / wf->fmt.ch;
+    size_t i, done = 0, got;
+    size_t phase = 0;
+    double acc = 0;
+    do
+    {
+        got = WAV_read_doubles(wf, ctx->energy, MIN(block, (count - done) * decim - phase));
+        for (i = 0; i < got * wf->fmt.ch; i++)
+        {
+            acc += fabs(ctx->energy[i]);
+            if ((i + 1) % wf->fmt.ch == 0 && ++phase == decim)
+            {
+                env[done++] = (float)(acc / (decim * wf->fmt.ch));
+                acc = 0;
+                phase = 0;
+            }
+        }
+    } while (got && done < count);
+    return done;
+}
+
+
+/**
+*   Find best match offset between two WAV files at current read positions.
+*   For large search range, offset is found on decimated envelopes or by
+*   spectral landmarks first, then refined at full rate by match_window()
+*   around coarse estimate, at the part of files, where coarse match found;
+*   match confidence is then measured there with CONFIRM_SIZE_LOG window.
+*   File positions are restored.
+*   @return 0 if any file has no non-zero samples
+*/
+static int find_offset(
+    align_ctx_t *           ctx,                //!< Alignment context
+    wav_file_t *            wf[2],              //!< Pair of files
+    long *                  offset,             //!< [OUT] Offset, samples: > 0 if 1st file is late, < 0 if 2nd
+    double *                frac,               //!< [OUT] Fractional offset correction, samples (NULL if not needed)
+    double *                at,                 //!< [OUT] Position in the 2nd file, where fractional offset measured
+    double *                residual,           //!< [OUT] Normalized match residual
+    double *                psr,                //!< [OUT] Peak-to-sidelobe ratio of the match (NULL if not needed)
+    int                     select              //!< Select window by content and escalate its size
+    )
+{
+    int i, k, ok = 0;
+    size_t samples[2];
+    size_t seg[2];
+    size_t range = ctx->max_offset / ctx->decim + 2;
+    size_t half = ctx->fft_size / wf[0]->fmt.ch / 2;
+    wavpos_t initialPos[2];
+    long coarse, finePos = 0;
+    long center[FINE_TRIES];
+    double coarseResidual, coarseFrac;
+
+    if (ctx->decim < 2)
+    {
+        return match_window(ctx, wf, ctx->fft_size, ctx->max_offset, offset, frac, at, residual, psr, select);
+    }
 
-    offs0 = bestMatch(g_input[0], samples[0]*wf[0]->fmt.ch, g_input[1], &w0, wf[0]->fmt.ch);
-    offs1 = bestMatch(g_input[1], samples[1]*wf[0]->fmt.ch, g_input[0], &w1, wf[0]->fmt.ch);
-    if (w1 < w0) 
+    for (i = 0; i < 2; i++)
     {
-        offs0 = offs1; 
-        wf[0] = wf[1];
+        initialPos[i] = WAV_get_file_pos(wf[i]);
     }
-    offset = offs0 / (int) wf[0]->fmt.ch;
-    if (offset >= samples[0])
+    // Stationary sound has no landmarks: fall back to envelope
+    if (ctx->coarse == E_ALIGN_COARSE_LANDMARKS &&
+        LANDMARK_find_offset(wf[0], wf[1], ctx->max_offset, &coarse))
     {
-        offset = 0;
+        // Landmarks match over the whole overlap: adjacent windows from its start
+        for (k = 0; k < FINE_TRIES; k++)
+        {
+            center[k] = MAX(-coarse, 0) + (long)half * (2*k + 1);
+        }
     }
     else
     {
-        fseek(wf[0]->file, offset * WAV_bytes_per_sample(wf[0]), SEEK_CUR);
+        for (i = 0; i < 2; i++)
+        {
+            samples[i] = read_envelope(ctx, wf[i], ctx->input[i], 4*range, ctx->decim);
+            WAV_set_file_pos(wf[i], initialPos[i]);
+        }
+        if (!samples[0] || !samples[1])
+        {
+            return 0;
+        }
+        coarse = bestMatch(ctx, ctx->input[0], samples[0], ctx->input[1], samples[1], range, 4*range, &coarseResidual, &coarseFrac, NULL, seg, 1, 1);
+        coarse *= (long)ctx->decim;
+        for (k = 0; k < FINE_TRIES; k++)
+        {
+            center[k] = (long)((seg[0] + seg[1] * (2*k + 1) / (2*FINE_TRIES)) * ctx->decim);
+        }
+    }
+
+    // Fine search at the part of files, matched by coarse search. Edit
+    // points may spoil single window, so few windows are tried over it.
+    *residual = 1;
+    for (k = 0; k < FINE_TRIES && *residual > 0.1; k++)
+    {
+        long pos[2];
+        long fineOffset;
+        double fineFrac, fineAt, fineResidual;
+        pos[1] = MAX(center[k] - (long)half, -coarse);
+        pos[1] = MAX(pos[1], 0);
+        pos[0] = pos[1] + coarse;
+        for (i = 0; i < 2; i++)
+        {
+            fseek(wf[i]->file, pos[i] * WAV_bytes_per_sample(wf[i]), SEEK_CUR);
+        }
+        if (match_window(ctx, wf, ctx->fft_size, ctx->fine_offset, &fineOffset, frac ? &fineFrac : NULL, &fineAt, &fineResidual, NULL, 0) &&
+            (!ok || fineResidual < *residual))
+        {
+            ok = 1;
+            *offset = coarse + fineOffset;
+            *residual = fineResidual;
+            finePos = pos[1];
+            if (frac)
+            {
+                *frac = fineFrac;
+                *at = fineAt + pos[1];
+            }
+        }
+        for (i = 0; i < 2; i++)
+        {
+            WAV_set_file_pos(wf[i], initialPos[i]);
+        }
+    }
+
+    // Fine window spans few lags, so its peak-to-sidelobe ratio means little.
+    // Confidence is measured at full rate over the matched part with larger
+    // window: selected by content and enlarged while confidence is low, as
+    // for direct search. That window may cover an edit point, so its
+    // correction to the offset is taken only if it matches no worse
+    if (ok && psr)
+    {
+        int window = MIN(1 << CONFIRM_SIZE_LOG, ctx->size_max);
+        long pos[2];
+        long confirmOffset;
+        double confirmFrac, confirmAt, confirmResidual;
+        pos[1] = MAX(finePos, -*offset);
+        pos[1] = MAX(pos[1], 0);
+        pos[0] = pos[1] + *offset;
+        for (i = 0; i < 2; i++)
+        {
+            fseek(wf[i]->file, pos[i] * WAV_bytes_per_sample(wf[i]), SEEK_CUR);
+        }
+        *psr = 0;
+        if (match_window(ctx, wf, window, window / wf[0]->fmt.ch / 8, &confirmOffset, frac ? &confirmFrac : NULL, &confirmAt,
+                         &confirmResidual, psr, select) && confirmResidual <= *residual)
+        {
+            *offset += confirmOffset;
+            *residual = confirmResidual;
+            if (frac)
+            {
+                *frac = confirmFrac;
+                *at = confirmAt + pos[1];
+            }
+        }
+        for (i = 0; i < 2; i++)
+        {
+            WAV_set_file_pos(wf[i], initialPos[i]);
+        }
+    }
+    return ok;
+}
+
+
+/**
+*   Align two WAV files, by moving current file read position.
+*/
+double ALIGN_align_pair (align_ctx_t * ctx, wav_file_t * wf0, wav_file_t * wf1)
+{
+    long offset;
+    double residual, psr;
+    wav_file_t * wf[2];
+    wf[0] = wf0;
+    wf[1] = wf1;
+
+    if (!find_offset(ctx, wf, &offset, NULL, NULL, &residual, &psr, 1))
+    {
+        // No non-zero samples: do not change position
+        return 0;
+    }
+    if (offset > 0)
+    {
+        fseek(wf0->file, offset * WAV_bytes_per_sample(wf0), SEEK_CUR);
+    }
+    else if (offset < 0)
+    {
+        fseek(wf1->file, -offset * WAV_bytes_per_sample(wf1), SEEK_CUR);
+    }
+    return psr;
+}
+
+
+/**
+*   Find best match offset between two WAV files at current read positions.
+*   File positions are not changed.
+*/
+int ALIGN_find_offset (align_ctx_t * ctx, wav_file_t * wf0, wav_file_t * wf1, long * offset)
+{
+    double residual;
+    wav_file_t * wf[2];
+    wf[0] = wf0;
+    wf[1] = wf1;
+    *offset = 0;
+    return find_offset(ctx, wf, offset, NULL, NULL, &residual, NULL, 0);
+}
+
+
+/**
+*   Convert interleaved samples to planar (channel after channel) in place.
+*   ctx->energy[] used as temporary buffer.
+*/
+static void deinterleave(align_ctx_t * ctx, float * p, size_t count, unsigned int ch)
+{
+    size_t i;
+    unsigned int c;
+    for (c = 0; c < ch; c++)
+    {
+        for (i = 0; i < count; i++)
+        {
+            ctx->energy[c*count + i] = p[i*ch + c];
+        }
+    }
+    for (i = 0; i < count * ch; i++)
+    {
+        p[i] = (float)ctx->energy[i];
+    }
+}
+
+
+/**
+*   Circular correlation of each channel of the windows, interleaved in
+*   ctx->input[], by one batched transform; see bestMatch() for the layout.
+*   Correlation of channel c, scaled by 2^n, goes to ctx->fft_input[1][],
+*   ch samples apart. Not done for mixed-radix windows: these are shorter
+*   enough to be faster one by one.
+*   @return n, log2 of transform size, or 0 if not done
+*/
+static int correlate_channels(align_ctx_t * ctx, size_t len, size_t max_offset, size_t seg, unsigned int ch)
+{
+    int size = fft_size_ceil(len);
+    int n = log2_ceil(size);
+    tricl_f_fft_batch_t * batch;
+
+    if ((size & (size - 1)) || ((size_t)ch << n) > (size_t)ctx->buf_size ||
+        !(batch = tricl_f_fft_batch_alloc(size, (int)ch)))
+    {
+        return 0;
+    }
+    tricl_f_fft_batch_r2c(batch, ctx->input[0], (int)len, ctx->fft_input[0]);
+    tricl_f_fft_batch_r2c(batch, ctx->input[1] + max_offset*ch, (int)seg, ctx->fft_input[1]);
+    tricl_f_fft_batch_mulpr_conj(batch, ctx->fft_input[0], ctx->fft_input[1]);
+    tricl_f_fft_batch_c2r(batch, ctx->fft_input[0], ctx->fft_input[1]);
+    tricl_f_fft_batch_free(batch);
+    return n;
+}
+
+
+/**
+*   Find best match offset for each channel separately. Channel without
+*   reliable match gets offset of the whole multichannel stream.
+*   File positions are not changed.
+*/
+int ALIGN_find_channel_offsets (align_ctx_t * ctx, wav_file_t * wf0, wav_file_t * wf1, long * offsets)
+{
+    int i, n;
+    unsigned int c, ch = wf0->fmt.ch;
+    size_t samples[2], seg[2], len, chRange, j;
+    size_t range = ctx->max_offset;
+    wavpos_t initialPos[2];
+    long pos[2] = {0, 0};
+    long common = 0;
+    double residual, frac;
+    wav_file_t * wf[2];
+    wf[0] = wf0;
+    wf[1] = wf1;
+
+    for (c = 0; c < ch; c++)
+    {
+        offsets[c] = 0;
+    }
+    if (ctx->decim > 1)
+    {
+        // Large range: search channels around common offset
+        if (!find_offset(ctx, wf, &common, NULL, NULL, &residual, NULL, 0))
+        {
+            return 0;
+        }
+        pos[common > 0 ? 0 : 1] = labs(common);
+        range = ctx->fine_offset;
+    }
+    for (i = 0; i < 2; i++)
+    {
+        initialPos[i] = WAV_get_file_pos(wf[i]);
+        fseek(wf[i]->file, pos[i] * WAV_bytes_per_sample(wf[i]), SEEK_CUR);
+    }
+    read_window(ctx, wf, samples, ctx->fft_size / ch);
+    for (i = 0; i < 2; i++)
+    {
+        WAV_set_file_pos(wf[i], initialPos[i]);
+    }
+    if (!samples[0] || !samples[1])
+    {
+        return 0;
     }
-    return;
+    if (ctx->decim < 2)
+    {
+        common = bestMatch(ctx, ctx->input[0], samples[0]*ch, ctx->input[1], samples[1]*ch, range, 4*range*ch, &residual, &frac, NULL, seg, ch, 0) / (long)ch;
+    }
+
+    // All channels by one batched transform, if it fits the buffers and the
+    // range is not cut by the window; else one by one. Window layout is the
+    // same as bestMatch() uses
+    len = MIN(MIN(samples[0], samples[1]), 4*range);
+    chRange = MIN(range, len*3/8);
+    seg[0] = chRange;
+    seg[1] = len - 2*chRange;
+    n = chRange == range ? correlate_channels(ctx, len, chRange, seg[1], ch) : 0;
+    deinterleave(ctx, ctx->input[0], samples[0], ch);
+    deinterleave(ctx, ctx->input[1], samples[1], ch);
+    for (c = 0; c < ch; c++)
+    {
+        const float * p0 = ctx->input[0] + c*samples[0];
+        const float * p1 = ctx->input[1] + c*samples[1];
+        long lag;
+        if (n)
+        {
+            for (j = 0; j < (size_t)1 << n; j++)
+            {
+                ctx->fft_input[0][j] = ctx->fft_input[1][j*ch + c];
+            }
+            lag = min_ssd_lag(ctx, ctx->fft_input[0], (double)((size_t)1 << n), p0, len, p1 + chRange, seg[1], chRange, chRange, n, 1, &residual, &frac, NULL);
+        }
+        else
+        {
+            lag = bestMatch(ctx, p0, samples[0], p1, samples[1], range, 4*range, &residual, &frac, NULL, seg, 1, 0);
+        }
+        offsets[c] = residual < 0.5 ? lag + (ctx->decim > 1 ? common : 0) : common;
+    }
+    return 1;
+}
+
+
+/**
+*   Find best match offset with sub-sample precision between two WAV files
+*   at current read positions. File positions are not changed.
+*/
+int ALIGN_find_delay (align_ctx_t * ctx, wav_file_t * wf0, wav_file_t * wf1, double * delay)
+{
+    long offset;
+    double frac, at, residual;
+    wav_file_t * wf[2];
+    wf[0] = wf0;
+    wf[1] = wf1;
+    *delay = 0;
+    if (!find_offset(ctx, wf, &offset, &frac, &at, &residual, NULL, 0))
+    {
+        return 0;
+    }
+    *delay = offset + frac;
+    return 1;
+}
+
+
+/**
+*   Least-squares line fit offset = a + b * pos over anchors, not marked as outliers.
+*   @return number of anchors used
+*/
+static int fit_line(const double * pos, const double * offset, const int * valid, int count, double * a, double * b)
+{
+    int i;
+    int n = 0;
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    double d;
+    for (i = 0; i < count; i++)
+    {
+        if (valid[i])
+        {
+            n++;
+            sx += pos[i];
+            sy += offset[i];
+        }
+    }
+    if (n < 2)
+    {
+        return 0;
+    }
+    sx /= n;
+    sy /= n;
+    for (i = 0; i < count; i++)
+    {
+        if (valid[i])
+        {
+            sxx += SQR(pos[i] - sx);
+            sxy += (pos[i] - sx) * (offset[i] - sy);
+        }
+    }
+    d = sxx > 0 ? sxy / sxx : 0;
+    *b = d;
+    *a = sy - d * sx;
+    return n;
 }
 
+
+/**
+*   Estimate linear clock drift between two WAV files, by finding best match
+*   offset at anchor points, evenly spaced over the common part of files.
+*   Offset at position pos of the 2nd file is modeled as offset + drift * pos,
+*   i.e. sample pos of the 2nd file matches sample pos*(1 + drift) + offset
+*   of the 1st one. Anchors with poor match or outlying offset are discarded.
+*   File positions are restored.
+*   @return number of anchors used for estimation, 0 if estimation failed
+*/
+int ALIGN_estimate_drift (align_ctx_t * ctx, wav_file_t * wf0, wav_file_t * wf1, int anchors, double * offset, double * drift)
+{
+    int i, k, used = 0;
+    wavpos_t initialPos[2];
+    wavpos_t length, step;
+    size_t window = ctx->fft_size / wf0->fmt.ch;
+    double * pos;
+    double * ofs;
+    int * valid;
+    wav_file_t * wf[2];
+    wf[0] = wf0;
+    wf[1] = wf1;
+
+    *offset = 0;
+    *drift = 0;
+    if (anchors < 2)
+    {
+        return 0;
+    }
+
+    pos   = malloc(anchors * sizeof(double));
+    ofs   = malloc(anchors * sizeof(double));
+    valid = malloc(anchors * sizeof(int));
+    if (!pos || !ofs || !valid)
+    {
+        FREE(pos);
+        FREE(ofs);
+        FREE(valid);
+        return 0;
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        initialPos[i] = WAV_get_file_pos(wf[i]);
+    }
+
+    length = MIN(WAV_get_remaining_samples(wf0), WAV_get_remaining_samples(wf1));
+    length -= (wavpos_t)window + ctx->max_offset;
+    step = length > 0 ? length / (anchors - 1) : 0;
+
+    for (k = 0; k < anchors; k++)
+    {
+        long lag;
+        double frac, at, residual;
+        wavpos_t p = step * k;
+
+        valid[k] = 0;
+        if (k && !step)
+        {
+            break;
+        }
+        for (i = 0; i < 2; i++)
+        {
+            WAV_set_file_pos(wf[i], initialPos[i] + p * WAV_bytes_per_sample(wf[i]));
+        }
+        if (find_offset(ctx, wf, &lag, &frac, &at, &residual, NULL, 0) && residual < 0.5)
+        {
+            pos[k] = p + at;
+            ofs[k] = lag + frac;
+            valid[k] = 1;
+        }
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        WAV_set_file_pos(wf[i], initialPos[i]);
+    }
+
+    // Fit line, dropping worst outlier one by one
+    while ((used = fit_line(pos, ofs, valid, anchors, offset, drift)) > 2)
+    {
+        int worst = -1;
+        double maxErr = 1.5;
+        for (k = 0; k < anchors; k++)
+        {
+            double err = fabs(ofs[k] - (*offset + *drift * pos[k]));
+            if (valid[k] && err > maxErr)
+            {
+                maxErr = err;
+                worst = k;
+            }
+        }
+        if (worst < 0)
+        {
+            break;
+        }
+        valid[worst] = 0;
+    }
+
+    FREE(pos);
+    FREE(ofs);
+    FREE(valid);
+    if (used < 2)
+    {
+        *offset = 0;
+        *drift = 0;
+        used = 0;
+    }
+    return used;
+}
+
+#ifdef f_wav_align_test
+/******************************************************************************
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+!!!!                                                                       !!!!
+!!!!                 !!!!!!!!  !!!!!!!!   !!!!!!!   !!!!!!!!               !!!!
+!!!!                    !!     !!        !!            !!                  !!!!
+!!!!                    !!     !!        !!            !!                  !!!!
+!!!!                    !!     !!!!!!     !!!!!!!      !!                  !!!!
+!!!!                    !!     !!               !!     !!                  !!!!
+!!!!                    !!     !!               !!     !!                  !!!!
+!!!!                    !!     !!!!!!!!   !!!!!!!      !!                  !!!!
+!!!!                                                                       !!!!
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+******************************************************************************/
+/*
+*   Alignment test: a clip, cut from the middle or the tail of a reference,
+*   is found inside it with either file order, by direct and coarse-to-fine
+*   search. Reference is noise with level changed every 1000 samples.
+*/
+
+#define TEST_HZ     44100
+
+typedef struct
+{
+    size_t ref_len;                                 // Reference, samples
+    size_t clip_pos;                                // Clip in the reference
+    size_t clip_len;
+    unsigned int range;                             // Search range, samples
+    size_t mem;                                     // Memory cap, bytes (0: default)
+} test_case_t;
+
+static const test_case_t test_cases[] =
+{
+    {TEST_HZ,       13230,        TEST_HZ/2,      16384,      0},
+    {4*TEST_HZ,     3*TEST_HZ/2,  2*TEST_HZ,      100000,     0},
+    {200*TEST_HZ,   100*TEST_HZ,  100*TEST_HZ,    4500000,    0},
+    {200*TEST_HZ,   100*TEST_HZ,  100*TEST_HZ,    4500000,    2000000000},
+};
+
+static int write_raw(const TCHAR * name, const double * x, size_t count)
+{
+    wav_file_t * wf = WAV_open_write(name, WAV_fmt(TEST_HZ, 1, 16, E_PCM_INTEGER), EFILE_RAW);
+    size_t written;
+    if (!wf)
+    {
+        return 0;
+    }
+    written = WAV_write_doubles(wf, x, count);
+    WAV_close_write(wf);
+    return written == count;
+}
+
+static int test_clip(const double * ref, const test_case_t * tc)
+{
+    static const TCHAR * name[2] = {_T("align0.raw"), _T("align1.raw")};
+    pcm_format_t fmt = WAV_fmt(TEST_HZ, 1, 16, E_PCM_INTEGER);
+    align_ctx_t * ctx = ALIGN_create(tc->range, 1, E_ALIGN_COARSE_ENVELOPE, tc->mem);
+    wav_file_t * wf[2] = {NULL, NULL};
+    long offset[2] = {0, 0};
+    int i, ok;
+
+    ok = ctx && write_raw(name[0], ref, tc->ref_len) && write_raw(name[1], ref + tc->clip_pos, tc->clip_len);
+    if (ok)
+    {
+        wf[0] = WAV_open_read(name[0], &fmt);
+        wf[1] = WAV_open_read(name[1], &fmt);
+        ok = wf[0] && wf[1] &&
+             ALIGN_find_offset(ctx, wf[0], wf[1], offset) &&
+             ALIGN_find_offset(ctx, wf[1], wf[0], offset + 1);
+        ok = ok && offset[0] == (long)tc->clip_pos && offset[1] == -(long)tc->clip_pos;
+    }
+    for (i = 0; i < 2; i++)
+    {
+        if (wf[i])
+        {
+            WAV_close_read(wf[i]);
+        }
+        _tremove(name[i]);
+    }
+    ALIGN_free(ctx);
+    printf("clip %lu at %lu of %lu, range %u: %ld %ld %s\n", (unsigned long)tc->clip_len, (unsigned long)tc->clip_pos,
+           (unsigned long)tc->ref_len, tc->range, offset[0], offset[1], ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(void)
+{
+    size_t len = 200*TEST_HZ;
+    double * ref = malloc(len * sizeof(double));
+    double gain = 0.1;
+    size_t i;
+    int ok = ref != NULL;
+
+    for (i = 0; ok && i < len; i++)
+    {
+        if (i % 1000 == 0)
+        {
+            gain = 0.02 + 0.3 * rand() / RAND_MAX;
+        }
+        ref[i] = gain * (2.0 * rand() / RAND_MAX - 1);
+    }
+    for (i = 0; ok && i < sizeof(test_cases) / sizeof(test_cases[0]); i++)
+    {
+        ok = test_clip(ref, test_cases + i) && ok;
+    }
+    free(ref);
+    return !ok;
+}
+
+// gcc -Df_wav_align_test -I. -Icompat *.c -lm -lpthread && ./a.out
+
+#endif // f_wav_align_test
@@ -1,5 +1,14 @@
 /** 18.12.2011 @file
-*  
+*   Find "best match" offset between two PCM files.
+*
+*   Search state is held in alignment context, so that files may be aligned
+*   concurrently, each thread with its own context.
+*
+*   Example:
+*
+*   align_ctx_t * a = ALIGN_create(maxOffset, ch, E_ALIGN_COARSE_ENVELOPE, 0);
+*   ALIGN_align_pair(a, wf0, wf1);
+*   ALIGN_free(a);
 */
 
 #ifndef f_wav_align_H_INCLUDED
@@ -12,9 +21,77 @@ extern "C" {
 #endif  //__cplusplus
 
 
-void ALIGN_align_pair (wav_file_t * wf0, wav_file_t * wf1);
-int ALIGN_init (unsigned int maxOffset, unsigned int maxCh);
-void ALIGN_close (void);
+typedef struct align_ctx_t align_ctx_t;
+
+/**
+*   Coarse search method, used when search range is too large for direct search
+*/
+typedef enum
+{
+    E_ALIGN_COARSE_ENVELOPE = 0,                //!< Cross-correlation of decimated envelopes
+    E_ALIGN_COARSE_LANDMARKS                    //!< Spectral peak landmarks (f_wav_landmark.h)
+} align_coarse_e;
+
+/**
+*   Create alignment context for search range of +-maxOffset samples and
+*   files of up to maxCh channels. Work buffers are kept within memLimit
+*   bytes (0: default, about 40 MB): larger ranges are searched
+*   coarse-to-fine. Landmarks search memory is not included.
+*   @return context, or NULL if no memory
+*/
+align_ctx_t * ALIGN_create (unsigned int maxOffset, unsigned int maxCh, align_coarse_e coarse, size_t memLimit);
+
+/**
+*   Release alignment context
+*/
+void ALIGN_free (align_ctx_t * ctx);
+
+/**
+*   Match confidence (peak-to-sidelobe ratio: normalized SSD at the best
+*   wrong lag over that at the best lag), below which alignment window is
+*   enlarged, and the result is reported as unreliable. Correct matches of
+*   lossy copies measure 6 and more, exact ones hundreds; unrelated signals
+*   and out of range offsets measure 1 to 1.1
+*/
+#define ALIGN_PSR_MIN 2
+
+/**
+*   Align two files, by moving read position of the late one. Alignment
+*   window is selected by signal content within few windows from current
+*   read positions, and enlarged, while the match is ambiguous.
+*   @return match confidence (peak-to-sidelobe ratio), 0 if not aligned
+*/
+double ALIGN_align_pair (align_ctx_t * ctx, wav_file_t * wf0, wav_file_t * wf1);
+
+/**
+*   Find best match offset: sample n of wf1 matches sample n + *offset of wf0,
+*   counting from current read positions. File positions are not changed.
+*   @return 0 if any file have no non-zero samples
+*/
+int ALIGN_find_offset (align_ctx_t * ctx, wav_file_t * wf0, wav_file_t * wf1, long * offset);
+
+/**
+*   Find best match offset with sub-sample precision: sample n of wf1
+*   matches (interpolated) sample n + *delay of wf0, counting from current
+*   read positions. File positions are not changed.
+*   @return 0 if any file have no non-zero samples
+*/
+int ALIGN_find_delay (align_ctx_t * ctx, wav_file_t * wf0, wav_file_t * wf1, double * delay);
+
+/**
+*   Find best match offset for each channel: sample n of wf1 channel c
+*   matches sample n + offsets[c] of wf0 channel c, counting from current
+*   read positions. File positions are not changed.
+*   @return 0 if any file have no non-zero samples
+*/
+int ALIGN_find_channel_offsets (align_ctx_t * ctx, wav_file_t * wf0, wav_file_t * wf1, long * offsets);
+
+/**
+*   Estimate linear clock drift: sample pos of wf1 matches sample
+*   pos*(1 + *drift) + *offset of wf0. File positions are not changed.
+*   @return number of anchor points used, 0 if failed
+*/
+int ALIGN_estimate_drift (align_ctx_t * ctx, wav_file_t * wf0, wav_file_t * wf1, int anchors, double * offset, double * drift);
 
 #ifdef __cplusplus
 }
@@ -41,7 +41,7 @@
 
 
 /************************************************************************/
-/*      Portable 64-bit file_size()                                     */
+/*      Portable 64-bit file_size(), file position and seek             */
 /************************************************************************/
 #if defined(_MSC_VER)
 #include <io.h>
@@ -52,11 +52,16 @@ static filesize_t file_size64(FILE * f)
 }
 #if _MSC_VER < 1300
 __int64 __cdecl _ftelli64(FILE *);
+int __cdecl _fseeki64(FILE *, __int64, int);
 #endif
 static filesize_t file_pos64(FILE * f)
 {
     return _ftelli64(f);
 }
+static int file_seek64(FILE * f, filesize_t pos)
+{
+    return _fseeki64(f, pos, SEEK_SET);
+}
 #elif defined(__GNUC__) && !defined(__arm)
 #include <sys/types.h>
 #include <sys/stat.h> 
@@ -74,6 +79,10 @@ static filesize_t file_pos64(FILE * f)
 {
     return ftello(f);
 }
+static int file_seek64(FILE * f, filesize_t pos)
+{
+    return fseeko(f, (off_t)pos, SEEK_SET);
+}
 #elif defined _WIN32 
 #include <windows.h>
 #include <io.h>
@@ -88,6 +97,10 @@ static filesize_t file_pos64(FILE * f)
 {
     return ftell(f);
 }
+static int file_seek64(FILE * f, filesize_t pos)
+{
+    return fseek(f, (long)pos, SEEK_SET);
+}
 #else
 typedef long filesize_t;
 static filesize_t file_size64(FILE * f)
@@ -102,6 +115,10 @@ static filesize_t file_pos64(FILE * f)
 {
     return ftell(f);
 }
+static int file_seek64(FILE * f, filesize_t pos)
+{
+    return fseek(f, (long)pos, SEEK_SET);
+}
 
 #endif
 
@@ -402,6 +419,23 @@ wavpos_t WAV_get_sample_pos(const wav_file_t *wf)
     return WAV_bytes_to_samples(wf, file_pos64(wf->file) - wf->header_bytes);
 }
 
+/**
+*   @return current file position in bytes (64-bit)
+*/
+wavpos_t WAV_get_file_pos(const wav_file_t *wf)
+{
+    return file_pos64(wf->file);
+}
+
+/**
+*   Set file position in bytes (64-bit)
+*   @return 0 if successful
+*/
+int WAV_set_file_pos(wav_file_t *wf, wavpos_t pos)
+{
+    return file_seek64(wf->file, pos);
+}
+
 /**
 *   @return remained data size in samples
 */
@@ -139,6 +139,18 @@ size_t WAV_read_floats (
 */    
 wavpos_t WAV_get_sample_pos(const wav_file_t *wf);
 
+/**
+*   @return current file position in bytes. Unlike ftell(), it is 64-bit
+*   on all platforms: position may be saved and restored for large files.
+*/    
+wavpos_t WAV_get_file_pos(const wav_file_t *wf);
+
+/**
+*   Set file position in bytes, as returned by WAV_get_file_pos().
+*   @return 0 if successful
+*/    
+int WAV_set_file_pos(wav_file_t *wf, wavpos_t pos);
+
 /**
 *   @return number of remaining samples.
 */    
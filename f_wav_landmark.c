@@ -0,0 +1,365 @@
+/** 18.10.2026 @file
+*   Coarse offset between two PCM files by spectral peak landmarks.
+*/
+#include "f_wav_landmark.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include "dsp_stft.h"
+
+#define DECIM               4                   // Mono downmix decimation
+#define FRAME_LOG           9                   // Analysis frame, decimated samples
+#define FRAME               (1 << FRAME_LOG)
+#define HOP                 (LANDMARK_HOP / DECIM)
+#define BIN_MIN             2                   // Lowest peak bin (skip DC)
+#define PEAKS_PER_FRAME     3                   // Max new peaks in a frame
+#define DECAY               0.99                // Peak masking threshold decay, per hop
+#define SPREAD_BINS         4                   // Peak masking spread over frequency, bins
+#define ONSET               1.26                // Min power rise of new peak over the previous frame (1 dB)
+#define FANOUT              4                   // Landmarks per anchor peak
+#define DT_MAX              63                  // Max time distance of landmark peaks, hops
+#define DF_MAX              63                  // Max frequency distance of landmark peaks, bins
+#define MAX_HASH_HITS       256                 // Hashes, repeated more often in the 1st file, ignored
+#define MIN_VOTES           8                   // Min votes for offset
+#define MIN_CONTRAST        2                   // Min ratio of votes for offset to votes for any other offset
+#define MATCH_LEN           (1 << 21)           // Overlap, fingerprinted beyond the search range, samples
+#define READ_BLOCK          4096                // Read buffer, samples
+#define FLOOR               (SQR(FRAME/4) * 1e-8)   // -80 dB from full scale sine
+#define SQR(x)              ((x)*(x))
+#define MAX( x, y )         ( (x)>(y)?(x):(y) )
+#define MIN( x, y )         ( (x)<(y)?(x):(y) )
+
+/**
+*   Spectrogram peak
+*/
+typedef struct
+{
+    unsigned long           frame;              //!< Hop index
+    int                     bin;                //!< Frequency bin
+} peak_t;
+
+/**
+*   Landmark: pair of peaks, hashed by anchor frequency, frequency and time distance
+*/
+typedef struct
+{
+    unsigned long           hash;
+    unsigned long           frame;              //!< Anchor peak hop index
+} landmark_t;
+
+/**
+*   Peak picker state
+*/
+typedef struct
+{
+    double                  pwr[FRAME/2 + 1];
+    double                  prev[FRAME/2 + 1];  //!< Power of the previous frame
+    double                  thr[FRAME/2 + 1];   //!< Masking threshold: decays in time, raised by peaks
+    double                  spread[3*SPREAD_BINS + 1];
+    peak_t *                peak;
+    size_t                  count;
+    size_t                  size;
+} picker_t;
+
+
+/**
+*   Pick peaks of one frame spectrum of decimated mono signal: local maxima
+*   over frequency, above masking threshold of earlier peaks, and ONSET times
+*   above the previous frame, so a sustained partial is picked at its onset
+*   only. Strongest first.
+*   @return 0 if no memory
+*/
+static int pick_frame(picker_t * p, const double * spec, unsigned long frameIdx)
+{
+    int k, n;
+    const double * pwr = p->pwr;
+
+    for (k = 0; k <= FRAME/2; k++)
+    {
+        p->prev[k] = p->pwr[k];
+        p->pwr[k] = SQR(spec[2*k]) + SQR(spec[2*k + 1]);
+        p->thr[k] *= DECAY;
+    }
+
+    for (n = 0; n < PEAKS_PER_FRAME; n++)
+    {
+        int best = 0;
+        for (k = BIN_MIN; k < FRAME/2; k++)
+        {
+            if (pwr[k] > pwr[k - 1] && pwr[k] >= pwr[k + 1] && pwr[k] > FLOOR &&
+                pwr[k] > p->thr[k] && pwr[k] > ONSET * p->prev[k] &&
+                (!best || pwr[k] > pwr[best]))
+            {
+                best = k;
+            }
+        }
+        if (!best)
+        {
+            break;
+        }
+        if (p->count == p->size)
+        {
+            size_t size = p->size ? p->size * 2 : 1024;
+            peak_t * peak = realloc(p->peak, size * sizeof(peak_t));
+            if (!peak)
+            {
+                return 0;
+            }
+            p->peak = peak;
+            p->size = size;
+        }
+        p->peak[p->count].frame = frameIdx;
+        p->peak[p->count].bin = best;
+        p->count++;
+
+        // Mask neighbours, including the peak itself
+        for (k = MAX(best - 3*SPREAD_BINS, 0); k <= MIN(best + 3*SPREAD_BINS, FRAME/2); k++)
+        {
+            p->thr[k] = MAX(p->thr[k], pwr[best] * p->spread[abs(k - best)]);
+        }
+    }
+    return 1;
+}
+
+
+/**
+*   Find spectrogram peaks over count samples from current position
+*   @return 0 if no memory
+*/
+static int find_peaks(wav_file_t * wf, wavpos_t count, peak_t ** peaks, size_t * npeaks)
+{
+    unsigned int ch = wf->fmt.ch;
+    picker_t * p = calloc(1, sizeof(picker_t));
+    double * buf = malloc(READ_BLOCK * ch * sizeof(double));
+    stft_t * stft = STFT_alloc(1, FRAME, HOP, NULL);
+    double x[READ_BLOCK / DECIM + 1];
+    double acc = 0;
+    unsigned long frameIdx = 0;
+    size_t i, got, fill, used;
+    const double * in;
+    int k, phase = 0, ok = 1;
+
+    if (!p || !stft || !buf)
+    {
+        ok = 0;
+    }
+    else
+    {
+        for (k = 0; k <= 3*SPREAD_BINS; k++)
+        {
+            p->spread[k] = exp(-0.5*SQR((double)k/SPREAD_BINS));
+        }
+    }
+
+    while (ok && count > 0 && (got = WAV_read_doubles(wf, buf, (size_t)MIN(count, READ_BLOCK))) > 0)
+    {
+        count -= got;
+        // Mono downmix, decimated by averaging
+        fill = 0;
+        for (i = 0; i < got * ch; i++)
+        {
+            acc += buf[i];
+            if ((i + 1) % ch == 0 && ++phase == DECIM)
+            {
+                x[fill++] = acc / (DECIM * ch);
+                acc = 0;
+                phase = 0;
+            }
+        }
+        // Hann windowed frames, completed by the block
+        for (in = x; ok && STFT_process(stft, in, fill, &used); in += used, fill -= used)
+        {
+            ok = pick_frame(p, STFT_spectrum(stft, 0), frameIdx++);
+        }
+    }
+
+    *peaks = NULL;
+    *npeaks = 0;
+    free(buf);
+    STFT_free(stft);
+    if (p)
+    {
+        if (ok)
+        {
+            *peaks = p->peak;
+            *npeaks = p->count;
+        }
+        else
+        {
+            free(p->peak);
+        }
+        free(p);
+    }
+    return ok;
+}
+
+
+/**
+*   Pair each peak with few following ones
+*   @return landmarks array, or NULL if no memory
+*/
+static landmark_t * make_landmarks(const peak_t * peak, size_t npeaks, size_t * count)
+{
+    size_t i, j, n = 0;
+    landmark_t * lm = malloc((npeaks * FANOUT + 1) * sizeof(landmark_t));
+    if (!lm)
+    {
+        return NULL;
+    }
+    for (i = 0; i < npeaks; i++)
+    {
+        int pairs = 0;
+        for (j = i + 1; j < npeaks && pairs < FANOUT; j++)
+        {
+            unsigned long dt = peak[j].frame - peak[i].frame;
+            int df = peak[j].bin - peak[i].bin;
+            if (dt > DT_MAX)
+            {
+                break;
+            }
+            if (dt && abs(df) <= DF_MAX)
+            {
+                lm[n].hash = ((unsigned long)peak[i].bin << 13) | ((unsigned long)(df + DF_MAX) << 6) | dt;
+                lm[n].frame = peak[i].frame;
+                n++;
+                pairs++;
+            }
+        }
+    }
+    *count = n;
+    return lm;
+}
+
+
+static int cmp_landmarks(const void * a, const void * b)
+{
+    const landmark_t * x = (const landmark_t *)a;
+    const landmark_t * y = (const landmark_t *)b;
+    if (x->hash != y->hash)
+    {
+        return x->hash < y->hash ? -1 : 1;
+    }
+    return x->frame < y->frame ? -1 : x->frame > y->frame;
+}
+
+
+/**
+*   @return index of the first landmark with hash not less than given
+*/
+static size_t lower_bound(const landmark_t * lm, size_t count, unsigned long hash)
+{
+    size_t lo = 0, hi = count;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (lm[mid].hash < hash)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+
+/**
+*   Find landmarks of both files over the search range
+*   @return 0 if no memory
+*/
+static int file_landmarks(wav_file_t * wf, wavpos_t count, landmark_t ** lm, size_t * n)
+{
+    peak_t * peak;
+    size_t npeaks;
+    wavpos_t initialPos = WAV_get_file_pos(wf);
+    int ok = find_peaks(wf, count, &peak, &npeaks);
+    WAV_set_file_pos(wf, initialPos);
+    *lm = NULL;
+    if (ok)
+    {
+        *lm = make_landmarks(peak, npeaks, n);
+        free(peak);
+    }
+    return *lm != NULL;
+}
+
+
+int LANDMARK_find_offset (wav_file_t * wf0, wav_file_t * wf1, unsigned long maxOffset, long * offset)
+{
+    landmark_t * lm[2];
+    size_t n[2], i, k;
+    long range = (long)(maxOffset / LANDMARK_HOP) + 1;
+    long best = -1;
+    unsigned long bestVotes = 0;
+    unsigned long nextVotes = 0;
+    unsigned long * votes = calloc(2*range + 1, sizeof(unsigned long));
+    wavpos_t count = (wavpos_t)maxOffset + MATCH_LEN;
+
+    *offset = 0;
+    if (!votes)
+    {
+        return 0;
+    }
+    if (!file_landmarks(wf0, count, &lm[0], &n[0]) || !file_landmarks(wf1, count, &lm[1], &n[1]))
+    {
+        free(lm[0]);
+        free(votes);
+        return 0;
+    }
+    qsort(lm[0], n[0], sizeof(landmark_t), cmp_landmarks);
+
+    // Each pair of landmarks with the same hash votes for the offset between them
+    for (i = 0; i < n[1]; i++)
+    {
+        size_t from = lower_bound(lm[0], n[0], lm[1][i].hash);
+        size_t to = lower_bound(lm[0] + from, MIN(n[0] - from, MAX_HASH_HITS + 1), lm[1][i].hash + 1) + from;
+        if (to - from > MAX_HASH_HITS)
+        {
+            // Too common (stationary sound): no information
+            continue;
+        }
+        for (k = from; k < to; k++)
+        {
+            long d = (long)lm[0][k].frame - (long)lm[1][i].frame;
+            if (labs(d) <= range)
+            {
+                votes[d + range]++;
+            }
+        }
+    }
+
+    // Offset may fall between hops: peak of votes over 3 adjacent hops
+    for (i = 1; i + 1 < (size_t)(2*range + 1); i++)
+    {
+        unsigned long v = votes[i - 1] + votes[i] + votes[i + 1];
+        if (v > bestVotes)
+        {
+            bestVotes = v;
+            best = (long)i;
+        }
+    }
+    // Periodic or stationary sound votes for many offsets: ambiguous
+    for (i = 1; best >= 0 && i + 1 < (size_t)(2*range + 1); i++)
+    {
+        if (labs((long)i - best) > 3)
+        {
+            nextVotes = MAX(nextVotes, votes[i - 1] + votes[i] + votes[i + 1]);
+        }
+    }
+    if (best >= 0 && bestVotes >= MIN_VOTES && bestVotes >= MIN_CONTRAST * nextVotes)
+    {
+        double centre = best - range + (double)((long)votes[best + 1] - (long)votes[best - 1]) / bestVotes;
+        *offset = (long)floor(centre * LANDMARK_HOP + 0.5);
+    }
+    else
+    {
+        bestVotes = 0;
+    }
+
+    free(lm[0]);
+    free(lm[1]);
+    free(votes);
+    return (int)bestVotes;
+}
@@ -0,0 +1,42 @@
+/** 18.10.2026 @file
+*   Coarse offset between two PCM files by spectral peak landmarks
+*   ("audio fingerprint"): pairs of prominent spectrogram peaks are hashed
+*   by their frequencies and time distance, and matching hashes vote for
+*   the offset. Time and memory are proportional to the search range, so
+*   offsets of minutes are found without a transform of that size.
+*
+*   Example:
+*
+*   if (LANDMARK_find_offset(wf0, wf1, maxOffset, &offset))
+*   {
+*       // refine offset within +-LANDMARK_HOP samples
+*   }
+*/
+
+#ifndef f_wav_landmark_H_INCLUDED
+#define f_wav_landmark_H_INCLUDED
+
+#include "f_wav_io.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  //__cplusplus
+
+/**
+*   Spectrogram hop, samples: offset found is accurate to about one hop
+*/
+#define LANDMARK_HOP 256
+
+/**
+*   Find coarse offset: sample n of wf1 matches sample n + *offset of wf0,
+*   counting from current read positions, |*offset| <= maxOffset.
+*   File positions are restored.
+*   @return number of landmarks voted for the offset, 0 if not found
+*/
+int LANDMARK_find_offset (wav_file_t * wf0, wav_file_t * wf1, unsigned long maxOffset, long * offset);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif //f_wav_landmark_H_INCLUDED
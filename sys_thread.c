@@ -0,0 +1,123 @@
+/** 18.10.2026 @file
+*   Minimal portable threads
+*/
+#include "sys_thread.h"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+static volatile LONG g_lock = 0;
+#else
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+struct thread_t
+{
+    thread_proc_t           proc;
+    void *                  arg;
+#ifdef _WIN32
+    HANDLE                  handle;
+#else
+    pthread_t               handle;
+#endif
+};
+
+
+#ifdef _WIN32
+static unsigned __stdcall thread_entry(void * arg)
+{
+    thread_t * t = (thread_t *)arg;
+    t->proc(t->arg);
+    return 0;
+}
+#else
+static void * thread_entry(void * arg)
+{
+    thread_t * t = (thread_t *)arg;
+    t->proc(t->arg);
+    return NULL;
+}
+#endif
+
+
+thread_t * THREAD_create(thread_proc_t proc, void * arg)
+{
+    thread_t * t = malloc(sizeof(thread_t));
+    if (!t)
+    {
+        return NULL;
+    }
+    t->proc = proc;
+    t->arg = arg;
+#ifdef _WIN32
+    t->handle = (HANDLE)_beginthreadex(NULL, 0, thread_entry, t, 0, NULL);
+    if (!t->handle)
+#else
+    if (pthread_create(&t->handle, NULL, thread_entry, t))
+#endif
+    {
+        free(t);
+        return NULL;
+    }
+    return t;
+}
+
+
+void THREAD_join(thread_t * t)
+{
+    if (t)
+    {
+#ifdef _WIN32
+        WaitForSingleObject(t->handle, INFINITE);
+        CloseHandle(t->handle);
+#else
+        pthread_join(t->handle, NULL);
+#endif
+        free(t);
+    }
+}
+
+
+unsigned int THREAD_cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors ? si.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned int)n : 1;
+#endif
+}
+
+
+void THREAD_lock(void)
+{
+#ifdef _WIN32
+    // Spin lock: statically initialized, no setup/cleanup required
+    while (InterlockedExchange((LONG *)&g_lock, 1))
+    {
+        Sleep(0);
+    }
+#else
+    pthread_mutex_lock(&g_lock);
+#endif
+}
+
+
+void THREAD_unlock(void)
+{
+#ifdef _WIN32
+    InterlockedExchange((LONG *)&g_lock, 0);
+#else
+    pthread_mutex_unlock(&g_lock);
+#endif
+}
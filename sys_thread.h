@@ -0,0 +1,62 @@
+/** 18.10.2026 @file
+*   Minimal portable threads: start a function in a new thread and wait
+*   for it to finish (Win32 threads or POSIX threads).
+*
+*   Example:
+*
+*   thread_t * t = THREAD_create(worker, &arg);
+*   ...
+*   THREAD_join(t);
+*/
+
+#ifndef sys_thread_H_INCLUDED
+#define sys_thread_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif  //__cplusplus
+
+typedef struct thread_t thread_t;
+
+/**
+*   Thread function
+*/
+typedef void (*thread_proc_t)(void * arg);
+
+/**
+*   Start new thread
+*   @return thread handle, or NULL if thread can't be created
+*/
+thread_t * THREAD_create(
+    thread_proc_t           proc,               //!< Thread function
+    void *                  arg                 //!< Thread function argument
+    );
+
+/**
+*   Wait for thread completion and release the handle
+*/
+void THREAD_join(
+    thread_t *              t                   //!< Thread handle
+    );
+
+/**
+*   @return number of online processors (at least 1)
+*/
+unsigned int THREAD_cpu_count(void);
+
+/**
+*   Acquire process-wide lock, guarding short critical sections (shared
+*   tables setup). Not recursive.
+*/
+void THREAD_lock(void);
+
+/**
+*   Release process-wide lock
+*/
+void THREAD_unlock(void);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif //sys_thread_H_INCLUDED
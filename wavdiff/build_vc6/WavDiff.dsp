@@ -90,6 +90,7 @@ LINK32=link.exe
 # Begin Source File
 
 SOURCE=..\..\dsp_ffttricl.c
+# PROP Exclude_From_Build 1
 # End Source File
 # Begin Source File
 
@@ -97,6 +98,46 @@ SOURCE=..\..\dsp_ffttricl.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\dsp_ffttricl_api.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\dsp_ffttricl_simd.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\dsp_ffttricl_d.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\dsp_ffttricl_f.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\dsp_resample.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\dsp_resample.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\dsp_stft.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\dsp_stft.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\..\editlist.c
+# End Source File
+# Begin Source File
+
+SOURCE=.\..\editlist.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\f_wav_align.c
 # End Source File
 # Begin Source File
@@ -113,14 +154,46 @@ SOURCE=..\..\f_wav_io.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\f_wav_landmark.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\f_wav_landmark.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\..\glitch.c
+# End Source File
+# Begin Source File
+
+SOURCE=.\..\glitch.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\..\help.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\..\histogram.c
+# End Source File
+# Begin Source File
+
+SOURCE=.\..\histogram.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\..\output.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\..\statcache.c
+# End Source File
+# Begin Source File
+
+SOURCE=.\..\statcache.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\sys_dirlist.c
 # End Source File
 # Begin Source File
@@ -137,6 +210,14 @@ SOURCE=..\..\sys_gauge.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\sys_thread.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\sys_thread.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\..\wd.c
 # End Source File
 # Begin Source File
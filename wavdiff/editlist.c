@@ -0,0 +1,1333 @@
+/** 18.10.2026 @file
+*   Piecewise alignment of two PCM files ("audio diff").
+*
+*   Test file is walked in chunks of CHUNK_BLOCKS envelope blocks; each chunk
+*   is compared with the reference at current offset. On mismatch:
+*   - offset is searched near the current one with FFT correlation
+*     (ALIGN_find_offset, +-LOCAL_RANGE samples);
+*   - then over the whole reference, using decimated log-energy envelopes
+*     (coarse envelope scan, candidates verified with fine envelope, and
+*     refined to a sample with ALIGN_find_offset);
+*   - new offset is accepted, if the next chunk matches with it.
+*   Runs, left unmatched (too short for the walk), are searched again over
+*   the whole reference with fine envelope and squared error.
+*   Boundaries between runs with different offsets are then placed at the
+*   sample, which minimizes total squared error, and difference statistic
+*   is gathered for each matched segment.
+*   Envelope decimation grows with file duration (ENV_SIZE_MAX), so memory
+*   use is bounded.
+*/
+#include "editlist.h"
+#include "f_wav_align.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Envelope decimation (minimal), samples
+#define ENV_HOP_MIN         256
+
+// Max envelope length; decimation grows for longer files
+#define ENV_SIZE_MAX        (1 << 20)
+
+// Envelope floor, dB
+#define ENV_FLOOR_DB        -100.0
+
+// Comparison chunk, envelope blocks
+#define CHUNK_BLOCKS        16
+
+// Chunk mismatch: difference to signal energy ratio above this level...
+#define LOST_RATIO          0.01
+
+// ...and above average ratio of matching chunks by this factor
+#define LOST_JUMP           100
+
+// Initial average ratio of matching chunks
+#define BASELINE_INIT       0.005
+
+// Chunks with lower energy per sample are silent
+#define SILENCE             1e-8
+
+// Search range near the current offset, samples
+#define LOCAL_RANGE         (1024*8*2)
+
+// Global search: max mean squared envelope difference, dB^2
+#define MATCH_THR           9.0
+
+// Global search: coarse envelope decimation, window and step, envelope blocks
+#define COARSE              16
+#define COARSE_WIN          (COARSE * 16)
+#define COARSE_STEP         4
+
+// Global search: number of candidates, verified with fine envelope
+#define CANDIDATES          8
+
+// Max number of chunks, skipped after failed search
+#define BACKOFF_MAX         64
+
+// Unmatched runs, searched again over the whole reference: min and max
+// length of envelope window, number of candidates (short envelope windows
+// are ambiguous), and max samples, compared at each lag
+#define SHORT_BLOCKS_MIN    8
+#define SHORT_BLOCKS_MAX    COARSE_WIN
+#define SHORT_CANDIDATES    64
+#define SHORT_SAMPLES_MAX   (1 << 14)
+
+// Cost of unmatched sample at the boundary, relative to the test sample power
+#define SPLIT_COST          0.1
+
+// Read buffer size, samples
+#define BUF_SAMPLES         4096
+
+#define SQR(x)              ((x)*(x))
+#define MAX( x, y )         ( (x)>(y)?(x):(y) )
+#define MIN( x, y )         ( (x)<(y)?(x):(y) )
+
+struct edit_list_t
+{
+    edit_segment_t *        seg;
+    size_t                  count;
+    size_t                  size;
+};
+
+/**
+*   Run of test envelope blocks with the same mapping to the reference
+*/
+typedef struct
+{
+    int                     matched;            //!< 0 if run not found in the reference
+    wavpos_t                start;              //!< First test sample
+    wavpos_t                offset;             //!< Reference sample = test sample + offset
+} run_t;
+
+/**
+*   Matching context
+*/
+typedef struct
+{
+    wav_file_t *            wf[2];
+    wavpos_t                base[2];            //!< Initial file positions
+    wavpos_t                len[2];             //!< Samples after initial positions
+    long                    hop;                //!< Envelope decimation
+    long                    chunk;              //!< Comparison chunk, samples
+    double                  baseline;           //!< Average ratio of matching chunks
+    float *                 env[2];             //!< Envelopes, dB
+    long                    n[2];               //!< Envelope lengths
+    double *                prefix;             //!< Prefix sums of reference envelope
+    double *                buf[2];             //!< Read buffers (chunk size)
+    align_ctx_t *           align;              //!< Local offset search (+-LOCAL_RANGE)
+    run_t *                 run;
+    size_t                  runs;
+    size_t                  runs_size;
+} edit_ctx_t;
+
+
+/**
+*   Seek to given sample position (relative to initial position)
+*/
+static void seek_to(const edit_ctx_t * ctx, int i, wavpos_t pos)
+{
+    wav_file_t * wf = ctx->wf[i];
+    WAV_set_file_pos(wf, wf->header_bytes + (ctx->base[i] + pos) * WAV_bytes_per_sample(wf));
+}
+
+
+/**
+*   Read samples at given position (relative to initial position). Samples
+*   outside of file are returned as zeros.
+*/
+static void read_at(edit_ctx_t * ctx, int i, wavpos_t pos, double * buf, size_t count)
+{
+    wav_file_t * wf = ctx->wf[i];
+    unsigned int nch = wf->fmt.ch;
+    size_t got = 0;
+    size_t lead = 0;
+    if (pos < 0)
+    {
+        lead = (size_t)MIN(-pos, (wavpos_t)count);
+        memset(buf, 0, lead * nch * sizeof(double));
+        pos = 0;
+    }
+    if (pos < ctx->len[i] && lead < count)
+    {
+        seek_to(ctx, i, pos);
+        got = WAV_read_doubles(wf, buf + lead * nch, count - lead);
+    }
+    memset(buf + (lead + got) * nch, 0, (count - lead - got) * nch * sizeof(double));
+}
+
+
+/**
+*   Compute log-energy envelope of the file
+*/
+static float * make_envelope(edit_ctx_t * ctx, int i, long * n)
+{
+    wav_file_t * wf = ctx->wf[i];
+    unsigned int nch = wf->fmt.ch;
+    long hop = ctx->hop;
+    long count = (long)(ctx->len[i] / hop);
+    long k = 0, fill = 0;
+    double e = 0;
+    float * env = malloc(MAX(count, 1) * sizeof(float));
+    if (!env)
+    {
+        return NULL;
+    }
+    seek_to(ctx, i, 0);
+    while (k < count)
+    {
+        size_t j, got = WAV_read_doubles(wf, ctx->buf[i], BUF_SAMPLES);
+        const double * p = ctx->buf[i];
+        if (!got)
+        {
+            break;
+        }
+        for (j = 0; j < got && k < count; j++)
+        {
+            unsigned int c;
+            for (c = 0; c < nch; c++, p++)
+            {
+                e += SQR(*p);
+            }
+            if (++fill == hop)
+            {
+                e /= hop * nch;
+                env[k++] = (float)(e > 0 ? MAX(10 * log10(e), ENV_FLOOR_DB) : ENV_FLOOR_DB);
+                e = 0;
+                fill = 0;
+            }
+        }
+    }
+    *n = k;
+    return env;
+}
+
+
+/**
+*   Mean squared difference between test envelope window and reference
+*   envelope at given offset; HUGE_VAL if reference is out of range.
+*/
+static double env_dist(const edit_ctx_t * ctx, long t, long delta, long n)
+{
+    long i;
+    double d = 0;
+    const float * a = ctx->env[1] + t;
+    const float * b = ctx->env[0] + t + delta;
+    if (t + delta < 0 || t + delta + n > ctx->n[0] || n <= 0)
+    {
+        return HUGE_VAL;
+    }
+    for (i = 0; i < n; i++)
+    {
+        d += SQR(a[i] - b[i]);
+    }
+    return d / n;
+}
+
+
+/**
+*   Search offset in range delta +- range, nearest offsets are checked first.
+*   @return distance for best offset found
+*/
+static double search_local(const edit_ctx_t * ctx, long t, long n, long * delta, long range)
+{
+    long i;
+    long center = *delta;
+    double best = env_dist(ctx, t, center, n);
+    for (i = 1; i <= range; i++)
+    {
+        double d = env_dist(ctx, t, center - i, n);
+        if (d < best)
+        {
+            best = d;
+            *delta = center - i;
+        }
+        d = env_dist(ctx, t, center + i, n);
+        if (d < best)
+        {
+            best = d;
+            *delta = center + i;
+        }
+    }
+    return best;
+}
+
+
+/**
+*   Search offset over the whole reference, using coarse envelope.
+*   @return distance for best offset found
+*/
+static double search_global(const edit_ctx_t * ctx, long t, long n, long * delta)
+{
+    double tc[COARSE_WIN / COARSE];
+    double cand_dist[CANDIDATES];
+    long cand[CANDIDATES];
+    int ncand = 0;
+    int i, k;
+    long r;
+    double best = HUGE_VAL;
+    const double * P = ctx->prefix;
+
+    if (t + COARSE_WIN > ctx->n[1])
+    {
+        return HUGE_VAL;
+    }
+    for (k = 0; k < COARSE_WIN / COARSE; k++)
+    {
+        tc[k] = 0;
+        for (i = 0; i < COARSE; i++)
+        {
+            tc[k] += ctx->env[1][t + k * COARSE + i];
+        }
+        tc[k] /= COARSE;
+    }
+
+    for (r = 0; r + COARSE_WIN <= ctx->n[0]; r += COARSE_STEP)
+    {
+        double d = 0;
+        for (k = 0; k < COARSE_WIN / COARSE; k++)
+        {
+            double rc = (P[r + (k + 1) * COARSE] - P[r + k * COARSE]) / COARSE;
+            d += SQR(tc[k] - rc);
+        }
+
+        // Keep best candidates, not closer than COARSE blocks to each other
+        for (i = 0; i < ncand && labs(cand[i] - r) >= COARSE; i++)
+        {
+        }
+        if (i < ncand)
+        {
+            if (d < cand_dist[i])
+            {
+                cand_dist[i] = d;
+                cand[i] = r;
+            }
+            continue;
+        }
+        if (ncand < CANDIDATES)
+        {
+            i = ncand++;
+        }
+        else
+        {
+            int worst = 0;
+            for (i = 1; i < ncand; i++)
+            {
+                if (cand_dist[i] > cand_dist[worst])
+                {
+                    worst = i;
+                }
+            }
+            if (d >= cand_dist[worst])
+            {
+                continue;
+            }
+            i = worst;
+        }
+        cand_dist[i] = d;
+        cand[i] = r;
+    }
+
+    // Verify candidates with fine envelope
+    for (i = 0; i < ncand; i++)
+    {
+        long d = cand[i] - t;
+        double dist = search_local(ctx, t, n, &d, COARSE_STEP * 2);
+        if (dist < best)
+        {
+            best = dist;
+            *delta = d;
+        }
+    }
+    return best;
+}
+
+
+static int add_run(edit_ctx_t * ctx, wavpos_t start, wavpos_t offset, int matched)
+{
+    if (ctx->runs == ctx->runs_size)
+    {
+        size_t size = ctx->runs_size ? ctx->runs_size * 2 : 64;
+        run_t * p = realloc(ctx->run, size * sizeof(run_t));
+        if (!p)
+        {
+            return 0;
+        }
+        ctx->run = p;
+        ctx->runs_size = size;
+    }
+    ctx->run[ctx->runs].start = start;
+    ctx->run[ctx->runs].offset = offset;
+    ctx->run[ctx->runs].matched = matched;
+    ctx->runs++;
+    return 1;
+}
+
+
+/**
+*   Compare test chunk with the reference at given offset
+*   @return difference to signal energy ratio, or -1 if both are silent
+*/
+static double chunk_ratio(edit_ctx_t * ctx, wavpos_t pos, wavpos_t offset, size_t count, double * e_test)
+{
+    unsigned int nch = ctx->wf[1]->fmt.ch;
+    size_t k;
+    double e_ref = 0, e_diff = 0;
+    read_at(ctx, 0, pos + offset, ctx->buf[0], count);
+    read_at(ctx, 1, pos, ctx->buf[1], count);
+    *e_test = 0;
+    for (k = 0; k < count * nch; k++)
+    {
+        double r = ctx->buf[0][k];
+        double t = ctx->buf[1][k];
+        e_ref += SQR(r);
+        *e_test += SQR(t);
+        e_diff += SQR(t - r);
+    }
+    if (e_ref + *e_test < SILENCE * count * nch)
+    {
+        return -1;
+    }
+    return e_diff / (e_ref + *e_test);
+}
+
+
+/**
+*   @return 1 if chunk ratio means match
+*/
+static int chunk_match(const edit_ctx_t * ctx, double ratio)
+{
+    return ratio <= MAX(LOST_RATIO, LOST_JUMP * ctx->baseline);
+}
+
+
+/**
+*   Find offset with FFT correlation, starting from approximate one, and
+*   verify it with the next chunk.
+*   @return 1 if found
+*/
+static int try_offset(edit_ctx_t * ctx, wavpos_t pos, wavpos_t * offset)
+{
+    wavpos_t ref = MAX(0, pos + *offset);
+    wavpos_t next = pos + ctx->chunk < ctx->len[1] ? pos + ctx->chunk : pos;
+    wavpos_t found;
+    double e_test;
+    long lag;
+    if (ref >= ctx->len[0])
+    {
+        return 0;
+    }
+    seek_to(ctx, 0, ref);
+    seek_to(ctx, 1, pos);
+    if (!ALIGN_find_offset(ctx->align, ctx->wf[0], ctx->wf[1], &lag))
+    {
+        return 0;
+    }
+    found = ref + lag - pos;
+    if (!chunk_match(ctx, chunk_ratio(ctx, next, found, (size_t)MIN(ctx->chunk, ctx->len[1] - next), &e_test)))
+    {
+        return 0;
+    }
+    *offset = found;
+    return 1;
+}
+
+
+/**
+*   Search new offset for test chunk: near the current offset, then over
+*   the whole reference.
+*   @return 1 if found
+*/
+static int search_offset(edit_ctx_t * ctx, wavpos_t pos, wavpos_t * offset)
+{
+    long t = (long)(pos / ctx->hop);
+    long delta = (long)(*offset / ctx->hop);
+    long n = MIN(2 * CHUNK_BLOCKS, ctx->n[1] - t);
+    wavpos_t found = *offset;
+
+    // Current chunk may contain the splice point: match envelope after it
+    if (t + CHUNK_BLOCKS + COARSE_WIN <= ctx->n[1])
+    {
+        t += CHUNK_BLOCKS;
+    }
+
+    if (try_offset(ctx, pos, &found))
+    {
+        *offset = found;
+        return 1;
+    }
+    if (n > 0 && search_global(ctx, t, n, &delta) < MATCH_THR)
+    {
+        found = (wavpos_t)delta * ctx->hop;
+        if (try_offset(ctx, pos, &found))
+        {
+            *offset = found;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+*   Walk test file and split it into runs with constant offset
+*/
+static int walk(edit_ctx_t * ctx)
+{
+    wavpos_t pos = 0;
+    wavpos_t offset = 0;
+    int state = -1;                             // -1: no runs yet; 0: unmatched; 1: matched
+    long backoff = 1;
+    long wait = 0;
+
+    ctx->baseline = BASELINE_INIT;
+    while (pos < ctx->len[1])
+    {
+        size_t count = (size_t)MIN(ctx->chunk, ctx->len[1] - pos);
+        double e_test;
+        double ratio = chunk_ratio(ctx, pos, offset, count, &e_test);
+        int ok = chunk_match(ctx, ratio);
+        wavpos_t start = pos;
+        if (!ok && e_test >= SILENCE * count * ctx->wf[1]->fmt.ch)
+        {
+            if (wait)
+            {
+                wait--;
+            }
+            else if (search_offset(ctx, pos, &offset))
+            {
+                ok = 1;
+                backoff = 1;
+                ratio = -1;
+            }
+            else
+            {
+                wait = backoff;
+                backoff = MIN(backoff * 2, BACKOFF_MAX);
+            }
+        }
+        if (ok && ratio >= 0)
+        {
+            ctx->baseline += (ratio - ctx->baseline) / 8;
+        }
+
+        if (ok && ratio < 0 && state == 0)
+        {
+            // New offset found: take back preceding unmatched chunks, matching it
+            const run_t * u = ctx->run + ctx->runs - 1;
+            start = pos;
+            while (start - (wavpos_t)ctx->chunk >= u->start &&
+                chunk_match(ctx, chunk_ratio(ctx, start - ctx->chunk, offset, ctx->chunk, &e_test)))
+            {
+                start -= ctx->chunk;
+            }
+            if (start == u->start)
+            {
+                ctx->runs--;
+                state = ctx->runs ? 1 : -1;
+            }
+        }
+        if (ok && (state != 1 || ctx->run[ctx->runs - 1].offset != offset))
+        {
+            if (!add_run(ctx, start, offset, 1))
+            {
+                return 0;
+            }
+            state = 1;
+        }
+        else if (!ok && state != 0)
+        {
+            if (!add_run(ctx, pos, offset, 0))
+            {
+                return 0;
+            }
+            state = 0;
+        }
+        pos += count;
+    }
+    return 1;
+}
+
+
+/**
+*   Find the sample offset near ref - pos with min squared error over
+*   count test samples from pos; test[] holds them.
+*   @return difference to signal energy ratio, or HUGE_VAL if test is silent
+*/
+static double refine_lag(edit_ctx_t * ctx, wavpos_t pos, const double * test, size_t count, wavpos_t ref, double * buf, wavpos_t * offset)
+{
+    unsigned int nch = ctx->wf[1]->fmt.ch;
+    double bestSsd = HUGE_VAL, e_ref = 0, e_test = 0;
+    long lag, bestLag = 0;
+    size_t k;
+
+    // Lags over +-hop samples from ref
+    read_at(ctx, 0, ref - ctx->hop, buf, count + 2 * ctx->hop);
+    for (lag = 0; lag <= 2 * ctx->hop; lag++)
+    {
+        const double * b = buf + lag * nch;
+        double ssd = 0;
+        for (k = 0; k < count * nch && ssd < bestSsd; k++)
+        {
+            ssd += SQR(test[k] - b[k]);
+        }
+        if (ssd < bestSsd)
+        {
+            bestSsd = ssd;
+            bestLag = lag;
+        }
+    }
+    for (k = 0; k < count * nch; k++)
+    {
+        e_test += SQR(test[k]);
+        e_ref += SQR(buf[bestLag * nch + k]);
+    }
+    *offset = ref - ctx->hop + bestLag - pos;
+    return e_test >= SILENCE * count * nch ? bestSsd / (e_ref + e_test) : HUGE_VAL;
+}
+
+
+/**
+*   Search unmatched run, which is shorter than global search window, over
+*   the whole reference: best SHORT_CANDIDATES fine envelope matches are
+*   refined to a sample by squared error.
+*   @return 0 if no memory
+*/
+static int find_short_run(edit_ctx_t * ctx, size_t idx)
+{
+    run_t * r = ctx->run + idx;
+    wavpos_t end = idx + 1 < ctx->runs ? r[1].start : ctx->len[1];
+    unsigned int nch = ctx->wf[1]->fmt.ch;
+    long t = (long)((r->start + ctx->hop - 1) / ctx->hop);
+    long n = MIN((long)(end / ctx->hop) - t, SHORT_BLOCKS_MAX);
+    double cand_dist[SHORT_CANDIDATES];
+    long cand[SHORT_CANDIDATES];
+    int i, j, ncand = 0;
+    long d;
+    double best = HUGE_VAL, prev = HUGE_VAL, prev2 = HUGE_VAL;
+    size_t count;
+    wavpos_t pos;
+    double * test, * buf;
+
+    if (n < SHORT_BLOCKS_MIN)
+    {
+        return 1;
+    }
+    for (d = -t; d + t + n <= ctx->n[0]; d++)
+    {
+        double dist = env_dist(ctx, t, d, n);
+        // Keep best local minima of distance: a match is within a block of one
+        if (prev < MATCH_THR && prev < prev2 && prev <= dist)
+        {
+            if (ncand < SHORT_CANDIDATES)
+            {
+                i = ncand++;
+                cand_dist[i] = HUGE_VAL;
+            }
+            else
+            {
+                // Replace the worst one
+                for (i = 0, j = 1; j < ncand; j++)
+                {
+                    if (cand_dist[j] > cand_dist[i])
+                    {
+                        i = j;
+                    }
+                }
+            }
+            if (prev < cand_dist[i])
+            {
+                cand_dist[i] = prev;
+                cand[i] = d - 1;
+            }
+        }
+        prev2 = prev;
+        prev = dist;
+    }
+    if (!ncand)
+    {
+        return 1;
+    }
+
+    pos = (wavpos_t)t * ctx->hop;
+    count = (size_t)MIN((wavpos_t)n * ctx->hop, SHORT_SAMPLES_MAX);
+    test = malloc(count * nch * sizeof(double));
+    buf = malloc((count + 2 * ctx->hop) * nch * sizeof(double));
+    if (!test || !buf)
+    {
+        free(test);
+        free(buf);
+        return 0;
+    }
+    read_at(ctx, 1, pos, test, count);
+    for (i = 0; i < ncand; i++)
+    {
+        wavpos_t offset;
+        double ratio = refine_lag(ctx, pos, test, count, pos + (wavpos_t)cand[i] * ctx->hop, buf, &offset);
+        if (ratio < best && chunk_match(ctx, ratio))
+        {
+            best = ratio;
+            r->matched = 1;
+            r->offset = offset;
+        }
+    }
+    free(test);
+    free(buf);
+
+    // Offset of a neighbour run is kept, if it matches as well: no split
+    for (i = 0; i < 2 && r->matched; i++)
+    {
+        const run_t * nb = i ? (idx + 1 < ctx->runs ? r + 1 : NULL) : (idx ? r - 1 : NULL);
+        double e_test;
+        if (nb && nb->matched && nb->offset != r->offset && labs((long)(nb->offset - r->offset)) <= ctx->hop &&
+            chunk_match(ctx, chunk_ratio(ctx, pos, nb->offset, MIN(count, ctx->chunk), &e_test)))
+        {
+            r->offset = nb->offset;
+            break;
+        }
+    }
+    return 1;
+}
+
+
+/**
+*   Search unmatched runs again: a run, shorter than two chunks and global
+*   search window, is not found by walk(), e.g. a short repeated block
+*/
+static int find_short_runs(edit_ctx_t * ctx)
+{
+    size_t i;
+    for (i = 0; i < ctx->runs; i++)
+    {
+        if (!ctx->run[i].matched && !find_short_run(ctx, i))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+/**
+*   Squared error of test samples for given run mapping
+*/
+static void split_cost(edit_ctx_t * ctx, const run_t * r, wavpos_t pos, size_t count, const double * test, double * cost)
+{
+    unsigned int nch = ctx->wf[1]->fmt.ch;
+    size_t k;
+    unsigned int c;
+    if (r->matched)
+    {
+        read_at(ctx, 0, pos + r->offset, ctx->buf[0], count);
+    }
+    for (k = 0; k < count; k++)
+    {
+        double e = 0;
+        for (c = 0; c < nch; c++)
+        {
+            double t = test[k * nch + c];
+            e += r->matched ? SQR(t - ctx->buf[0][k * nch + c]) : SPLIT_COST * SQR(t);
+        }
+        cost[k] = e;
+    }
+}
+
+
+/**
+*   Place boundaries between runs at the sample, which minimizes total error
+*/
+static int refine_splits(edit_ctx_t * ctx)
+{
+    size_t i;
+    long region = 3 * ctx->chunk;
+    unsigned int nch = ctx->wf[1]->fmt.ch;
+    double * cost[2];
+    double * test = malloc(region * nch * sizeof(double));
+    double * buf = ctx->buf[0];
+
+    cost[0] = malloc(region * sizeof(double));
+    cost[1] = malloc(region * sizeof(double));
+    ctx->buf[0] = malloc(region * nch * sizeof(double));
+    if (!test || !cost[0] || !cost[1] || !ctx->buf[0])
+    {
+        free(test);
+        free(cost[0]);
+        free(cost[1]);
+        free(ctx->buf[0]);
+        ctx->buf[0] = buf;
+        return 0;
+    }
+
+    for (i = 1; i < ctx->runs; i++)
+    {
+        run_t * a = ctx->run + i - 1;
+        run_t * b = ctx->run + i;
+        // Splice point may be up to 2 chunks before the start of run: chunk with a
+        // small part of mismatch may pass, and the next one may be not matched at all
+        wavpos_t lo = MAX(a->start, b->start - 2 * ctx->chunk);
+        wavpos_t hi = MIN(b->start + ctx->chunk, i + 1 < ctx->runs ? b[1].start : ctx->len[1]);
+        size_t count, k, split = 0;
+        double sum, best;
+        if (hi <= lo)
+        {
+            continue;
+        }
+        count = (size_t)(hi - lo);
+        read_at(ctx, 1, lo, test, count);
+        split_cost(ctx, a, lo, count, test, cost[0]);
+        split_cost(ctx, b, lo, count, test, cost[1]);
+
+        // Total error = sum(cost[0][0..split)) + sum(cost[1][split..count))
+        sum = 0;
+        for (k = 0; k < count; k++)
+        {
+            sum += cost[1][k];
+        }
+        best = sum;
+        for (k = 0; k < count; k++)
+        {
+            sum += cost[0][k] - cost[1][k];
+            if (sum < best)
+            {
+                best = sum;
+                split = k + 1;
+            }
+        }
+        b->start = lo + split;
+    }
+
+    free(test);
+    free(cost[0]);
+    free(cost[1]);
+    free(ctx->buf[0]);
+    ctx->buf[0] = buf;
+    return 1;
+}
+
+
+/**
+*   Insert zeroed segment at idx, without merging
+*   @return NULL if no memory
+*/
+static edit_segment_t * insert_segment(edit_list_t * e, size_t idx)
+{
+    edit_segment_t * s;
+    if (e->count == e->size)
+    {
+        size_t size = e->size ? e->size * 2 : 64;
+        edit_segment_t * p = realloc(e->seg, size * sizeof(edit_segment_t));
+        if (!p)
+        {
+            return NULL;
+        }
+        e->seg = p;
+        e->size = size;
+    }
+    s = e->seg + idx;
+    memmove(s + 1, s, (e->count - idx) * sizeof(edit_segment_t));
+    e->count++;
+    memset(s, 0, sizeof(*s));
+    return s;
+}
+
+
+static int add_segment(edit_list_t * e, size_t idx, edit_type_e type, wavpos_t pos0, wavpos_t pos1, wavpos_t len)
+{
+    edit_segment_t * s;
+    if (len <= 0)
+    {
+        return 1;
+    }
+    s = idx ? e->seg + idx - 1 : NULL;
+    if (idx == e->count && s && s->type == type && type != E_EDIT_DELETE &&
+        s->pos[1] + s->len == pos1 && (type == E_EDIT_INSERT || s->pos[0] + s->len == pos0))
+    {
+        // Merge with previous segment
+        s->len += len;
+        return 1;
+    }
+    s = insert_segment(e, idx);
+    if (!s)
+    {
+        return 0;
+    }
+    s->type = type;
+    s->pos[0] = pos0;
+    s->pos[1] = pos1;
+    s->len = len;
+    return 1;
+}
+
+
+static int is_copy(const edit_segment_t * s)
+{
+    return s->type == E_EDIT_MATCH || s->type == E_EDIT_REPEAT;
+}
+
+
+/**
+*   Split copied segments at the edges of reference parts, already copied
+*   to the test by earlier segments, and mark the overlapping parts as
+*   repeats
+*   @return 0 if no memory
+*/
+static int mark_repeats(edit_list_t * e)
+{
+    size_t i, j;
+    for (i = 0; i < e->count; i++)
+    {
+        edit_segment_t * s = e->seg + i;
+        wavpos_t start = s->pos[0], end = s->pos[0] + s->len;
+        wavpos_t split = end;
+        int repeat = 0;
+        if (!is_copy(s))
+        {
+            continue;
+        }
+        // Covered head is repeated up to the end of covering part, else
+        // copied up to the start of the next covered part
+        for (j = 0; j < i; j++)
+        {
+            const edit_segment_t * p = e->seg + j;
+            if (is_copy(p) && p->pos[0] <= start && p->pos[0] + p->len > start && (!repeat || p->pos[0] + p->len > split))
+            {
+                repeat = 1;
+                split = MIN(end, p->pos[0] + p->len);
+            }
+        }
+        for (j = 0; j < i && !repeat; j++)
+        {
+            const edit_segment_t * p = e->seg + j;
+            if (is_copy(p) && p->pos[0] > start && p->pos[0] < split)
+            {
+                split = p->pos[0];
+            }
+        }
+        s->type = repeat ? E_EDIT_REPEAT : E_EDIT_MATCH;
+        if (split < end)
+        {
+            // Rest is checked as the next segment
+            edit_segment_t * n = insert_segment(e, i + 1);
+            if (!n)
+            {
+                return 0;
+            }
+            s = e->seg + i;
+            *n = *s;
+            n->pos[0] += split - start;
+            n->pos[1] += split - start;
+            n->len -= split - start;
+            s->len = split - start;
+        }
+    }
+    return 1;
+}
+
+
+/**
+*   Add deleted segments: reference parts, not copied to the test. Deleted
+*   segment is placed after the segment, which copies reference part just
+*   before it.
+*/
+static int add_deletions(edit_list_t * e, wavpos_t len)
+{
+    wavpos_t pos = 0;
+    while (pos < len)
+    {
+        size_t i, idx = 0;
+        wavpos_t next = len;
+        wavpos_t covered = pos;
+        wavpos_t test_pos = 0;
+
+        // Extend covered part from pos
+        for (i = 0; i < e->count; i++)
+        {
+            const edit_segment_t * s = e->seg + i;
+            if (is_copy(s) && s->pos[0] <= covered && s->pos[0] + s->len > covered)
+            {
+                covered = s->pos[0] + s->len;
+                i = (size_t)-1;
+            }
+        }
+        if (covered >= len)
+        {
+            break;
+        }
+
+        // Gap [covered, next): find next copied part and insertion point
+        for (i = 0; i < e->count; i++)
+        {
+            const edit_segment_t * s = e->seg + i;
+            if (is_copy(s) && s->pos[0] > covered && s->pos[0] < next)
+            {
+                next = s->pos[0];
+                if (!covered)
+                {
+                    test_pos = s->pos[1];
+                }
+            }
+            if (is_copy(s) && s->pos[0] + s->len == covered && covered && !idx)
+            {
+                idx = i + 1;
+                test_pos = s->pos[1] + s->len;
+            }
+        }
+        if (!covered)
+        {
+            // Deleted head: insert before the segment, which copies its end
+            for (idx = 0; idx < e->count && !(is_copy(e->seg + idx) && e->seg[idx].pos[0] == next); idx++)
+            {
+            }
+            if (idx == e->count)
+            {
+                idx = 0;
+            }
+        }
+        else if (!idx)
+        {
+            idx = e->count;
+        }
+        if (!add_segment(e, idx, E_EDIT_DELETE, covered, test_pos, next - covered))
+        {
+            return 0;
+        }
+        pos = next;
+    }
+    return 1;
+}
+
+
+/**
+*   Convert runs into edit list segments
+*/
+static int make_segments(edit_ctx_t * ctx, edit_list_t * e)
+{
+    size_t i;
+    int ok = 1;
+    for (i = 0; i < ctx->runs && ok; i++)
+    {
+        const run_t * r = ctx->run + i;
+        wavpos_t start = r->start;
+        wavpos_t end = i + 1 < ctx->runs ? r[1].start : ctx->len[1];
+        wavpos_t stop = end;
+        if (!r->matched)
+        {
+            ok = add_segment(e, e->count, E_EDIT_INSERT, 0, start, end - start);
+            continue;
+        }
+
+        // Parts of the run outside of the reference are inserted
+        if (start + r->offset < 0)
+        {
+            wavpos_t head = MIN(-(start + r->offset), end - start);
+            ok = add_segment(e, e->count, E_EDIT_INSERT, 0, start, head);
+            start += head;
+        }
+        if (stop + r->offset > ctx->len[0])
+        {
+            stop = MAX(start, ctx->len[0] - r->offset);
+        }
+        ok = ok && add_segment(e, e->count, E_EDIT_MATCH, start + r->offset, start, stop - start);
+        ok = ok && add_segment(e, e->count, E_EDIT_INSERT, 0, stop, end - stop);
+    }
+
+    if (ok)
+    {
+        ok = mark_repeats(e) && add_deletions(e, ctx->len[0]);
+    }
+
+    // Insertion point in the reference: end of previous copied segment
+    for (i = 0; i < e->count && ok; i++)
+    {
+        edit_segment_t * s = e->seg + i;
+        if (s->type == E_EDIT_INSERT)
+        {
+            s->pos[0] = i ? e->seg[i - 1].pos[0] + (e->seg[i - 1].type == E_EDIT_INSERT ? 0 : e->seg[i - 1].len) : 0;
+        }
+    }
+    return ok;
+}
+
+
+/**
+*   Gather difference statistic for matched segments
+*/
+static void segment_stat(edit_ctx_t * ctx, edit_list_t * e)
+{
+    size_t i;
+    unsigned int nch = ctx->wf[0]->fmt.ch;
+    for (i = 0; i < e->count; i++)
+    {
+        edit_segment_t * s = e->seg + i;
+        wavpos_t done = 0;
+        if (s->type != E_EDIT_MATCH && s->type != E_EDIT_REPEAT)
+        {
+            continue;
+        }
+        while (done < s->len)
+        {
+            size_t k, count = (size_t)MIN(BUF_SAMPLES, s->len - done);
+            read_at(ctx, 0, s->pos[0] + done, ctx->buf[0], count);
+            read_at(ctx, 1, s->pos[1] + done, ctx->buf[1], count);
+            for (k = 0; k < count * nch; k++)
+            {
+                double d = ctx->buf[1][k] - ctx->buf[0][k];
+                s->d_sumSqr += SQR(d);
+                s->r_sumSqr += SQR(ctx->buf[0][k]);
+                s->d_abs_max = MAX(s->d_abs_max, fabs(d));
+            }
+            done += count;
+        }
+    }
+}
+
+
+edit_list_t * EDIT_build(wav_file_t * wf0, wav_file_t * wf1)
+{
+    int i;
+    size_t k;
+    int ok = 0;
+    wavpos_t initialPos[2];
+    edit_ctx_t ctx;
+    edit_list_t * e = calloc(1, sizeof(edit_list_t));
+    if (!e)
+    {
+        return NULL;
+    }
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.wf[0] = wf0;
+    ctx.wf[1] = wf1;
+    for (i = 0; i < 2; i++)
+    {
+        initialPos[i] = WAV_get_file_pos(ctx.wf[i]);
+        ctx.base[i] = WAV_get_sample_pos(ctx.wf[i]);
+        ctx.len[i] = WAV_get_remaining_samples(ctx.wf[i]);
+    }
+    ctx.hop = ENV_HOP_MIN;
+    while (MAX(ctx.len[0], ctx.len[1]) / ctx.hop > ENV_SIZE_MAX)
+    {
+        ctx.hop *= 2;
+    }
+    ctx.chunk = CHUNK_BLOCKS * ctx.hop;
+    for (i = 0; i < 2; i++)
+    {
+        ctx.buf[i] = malloc(MAX(ctx.chunk, BUF_SAMPLES) * ctx.wf[i]->fmt.ch * sizeof(double));
+    }
+
+    if (ctx.buf[0] && ctx.buf[1] &&
+        NULL != (ctx.align = ALIGN_create(LOCAL_RANGE, wf0->fmt.ch, E_ALIGN_COARSE_ENVELOPE, 0)) &&
+        NULL != (ctx.env[0] = make_envelope(&ctx, 0, &ctx.n[0])) &&
+        NULL != (ctx.env[1] = make_envelope(&ctx, 1, &ctx.n[1])) &&
+        NULL != (ctx.prefix = malloc((ctx.n[0] + 1) * sizeof(double))))
+    {
+        ctx.prefix[0] = 0;
+        for (k = 0; k < (size_t)ctx.n[0]; k++)
+        {
+            ctx.prefix[k + 1] = ctx.prefix[k] + ctx.env[0][k];
+        }
+        // Boundaries of runs, found by find_short_runs(), are refined again
+        ok = walk(&ctx) && refine_splits(&ctx) && find_short_runs(&ctx) && refine_splits(&ctx) && make_segments(&ctx, e);
+        if (ok)
+        {
+            segment_stat(&ctx, e);
+        }
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        WAV_set_file_pos(ctx.wf[i], initialPos[i]);
+        free(ctx.buf[i]);
+        free(ctx.env[i]);
+    }
+    free(ctx.prefix);
+    free(ctx.run);
+    ALIGN_free(ctx.align);
+
+    if (!ok)
+    {
+        EDIT_free(e);
+        return NULL;
+    }
+
+    // Report absolute file positions
+    for (k = 0; k < e->count; k++)
+    {
+        e->seg[k].pos[0] += ctx.base[0];
+        e->seg[k].pos[1] += ctx.base[1];
+    }
+    return e;
+}
+
+
+void EDIT_free(edit_list_t * e)
+{
+    if (e)
+    {
+        free(e->seg);
+        free(e);
+    }
+}
+
+
+size_t EDIT_count(const edit_list_t * e)
+{
+    return e->count;
+}
+
+
+const edit_segment_t * EDIT_segment(const edit_list_t * e, size_t i)
+{
+    return e->seg + i;
+}
+
+
+const TCHAR * EDIT_type_string(edit_type_e type)
+{
+    switch (type)
+    {
+    case E_EDIT_MATCH:  return _T("Match ");
+    case E_EDIT_REPEAT: return _T("Repeat");
+    case E_EDIT_INSERT: return _T("Insert");
+    case E_EDIT_DELETE: return _T("Delete");
+    }
+    return _T("?");
+}
+
+
+#ifdef editlist_test
+/******************************************************************************
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+!!!!                                                                       !!!!
+!!!!                 !!!!!!!!  !!!!!!!!   !!!!!!!   !!!!!!!!               !!!!
+!!!!                    !!     !!        !!            !!                  !!!!
+!!!!                    !!     !!        !!            !!                  !!!!
+!!!!                    !!     !!!!!!     !!!!!!!      !!                  !!!!
+!!!!                    !!     !!               !!     !!                  !!!!
+!!!!                    !!     !!               !!     !!                  !!!!
+!!!!                    !!     !!!!!!!!   !!!!!!!      !!                  !!!!
+!!!!                                                                       !!!!
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+******************************************************************************/
+/*
+*   Edit list test: reference is noise with varying envelope; test is the
+*   reference with a block of it repeated. Only the repeated part must be
+*   reported as repeat.
+*/
+#include <stdio.h>
+
+#define TEST_HZ     44100
+#define TEST_CH     2
+#define TEST_LEN    600000
+#define TEST_SPLICE 96000
+
+typedef struct
+{
+    wavpos_t pos;                                   // Repeated block in the reference
+    wavpos_t len;
+    edit_segment_t expect[3];
+} test_case_t;
+
+static const test_case_t test_cases[] =
+{
+    {48000, 48000, {
+        {E_EDIT_MATCH,  {0, 0},                           TEST_SPLICE},
+        {E_EDIT_REPEAT, {48000, TEST_SPLICE},             48000},
+        {E_EDIT_MATCH,  {TEST_SPLICE, TEST_SPLICE + 48000}, TEST_LEN - TEST_SPLICE}}},
+    {50000, 5000, {
+        {E_EDIT_MATCH,  {0, 0},                           TEST_SPLICE},
+        {E_EDIT_REPEAT, {50000, TEST_SPLICE},             5000},
+        {E_EDIT_MATCH,  {TEST_SPLICE, TEST_SPLICE + 5000}, TEST_LEN - TEST_SPLICE}}},
+};
+
+static int write_raw(const TCHAR * name, const double * x, wavpos_t count)
+{
+    wav_file_t * wf = WAV_open_write(name, WAV_fmt(TEST_HZ, TEST_CH, 16, E_PCM_INTEGER), EFILE_RAW);
+    size_t written;
+    if (!wf)
+    {
+        return 0;
+    }
+    written = WAV_write_doubles(wf, x, (size_t)count);
+    WAV_close_write(wf);
+    return written == (size_t)count;
+}
+
+static int test_repeat(const double * ref, const test_case_t * tc)
+{
+    static const TCHAR * name[2] = {_T("editlist0.raw"), _T("editlist1.raw")};
+    pcm_format_t fmt = WAV_fmt(TEST_HZ, TEST_CH, 16, E_PCM_INTEGER);
+    double * test = malloc((TEST_LEN + tc->len) * TEST_CH * sizeof(double));
+    wav_file_t * wf[2] = {NULL, NULL};
+    edit_list_t * e = NULL;
+    int i, ok;
+
+    ok = test != NULL;
+    if (ok)
+    {
+        memcpy(test, ref, TEST_SPLICE * TEST_CH * sizeof(double));
+        memcpy(test + TEST_SPLICE * TEST_CH, ref + tc->pos * TEST_CH, (size_t)tc->len * TEST_CH * sizeof(double));
+        memcpy(test + (TEST_SPLICE + tc->len) * TEST_CH, ref + TEST_SPLICE * TEST_CH, (TEST_LEN - TEST_SPLICE) * TEST_CH * sizeof(double));
+        ok = write_raw(name[0], ref, TEST_LEN) && write_raw(name[1], test, TEST_LEN + tc->len);
+    }
+    free(test);
+    if (ok)
+    {
+        wf[0] = WAV_open_read(name[0], &fmt);
+        wf[1] = WAV_open_read(name[1], &fmt);
+        e = wf[0] && wf[1] ? EDIT_build(wf[0], wf[1]) : NULL;
+        ok = e && EDIT_count(e) == 3;
+    }
+    for (i = 0; e && i < (int)EDIT_count(e); i++)
+    {
+        const edit_segment_t * s = EDIT_segment(e, i);
+        const edit_segment_t * x = tc->expect + i;
+        printf("%s %8ld %8ld %8ld\n", EDIT_type_string(s->type), (long)s->pos[0], (long)s->pos[1], (long)s->len);
+        ok = ok && s->type == x->type && s->pos[0] == x->pos[0] && s->pos[1] == x->pos[1] && s->len == x->len;
+    }
+    EDIT_free(e);
+    for (i = 0; i < 2; i++)
+    {
+        if (wf[i])
+        {
+            WAV_close_read(wf[i]);
+        }
+        _tremove(name[i]);
+    }
+    printf("repeat %ld at %ld: %s\n", (long)tc->len, (long)tc->pos, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(void)
+{
+    double * ref = malloc(TEST_LEN * TEST_CH * sizeof(double));
+    double gain = 0.1;
+    size_t i, k;
+    int ok = ref != NULL;
+
+    // Noise, with level changed every 1000 samples
+    for (i = 0; ok && i < TEST_LEN; i++)
+    {
+        if (i % 1000 == 0)
+        {
+            gain = 0.02 + 0.3 * rand() / RAND_MAX;
+        }
+        for (k = 0; k < TEST_CH; k++)
+        {
+            ref[i * TEST_CH + k] = gain * (2.0 * rand() / RAND_MAX - 1);
+        }
+    }
+    for (i = 0; ok && i < sizeof(test_cases) / sizeof(test_cases[0]); i++)
+    {
+        ok = test_repeat(ref, test_cases + i) && ok;
+    }
+    free(ref);
+    return !ok;
+}
+
+// gcc -Deditlist_test -I. -Icompat *.c wavdiff/editlist.c -lm -lpthread && ./a.out
+
+#endif // editlist_test
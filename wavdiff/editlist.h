@@ -0,0 +1,95 @@
+/** 18.10.2026 @file
+*   Piecewise alignment of two PCM files ("audio diff").
+*
+*   Test file is described as an edit list, applied to the reference file:
+*   segments, copied from the reference (possibly repeated), segments,
+*   inserted into the test file, and reference segments, deleted from it.
+*
+*   Example:
+*
+*   edit_list_t * e = EDIT_build(ref, test);
+*   for (i = 0; i < EDIT_count(e); i++) print(EDIT_segment(e, i));
+*   EDIT_free(e);
+*/
+
+#ifndef editlist_H_INCLUDED
+#define editlist_H_INCLUDED
+
+#include "f_wav_io.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  //__cplusplus
+
+/**
+*   Edit list segment type
+*/
+typedef enum
+{
+    E_EDIT_MATCH = 0,                       //!< Test segment copied from the reference
+    E_EDIT_REPEAT,                          //!< Test segment copied from already used part of the reference
+    E_EDIT_INSERT,                          //!< Test segment not found in the reference
+    E_EDIT_DELETE                           //!< Reference segment not found in the test
+} edit_type_e;
+
+/**
+*   Edit list segment. Positions are given in samples from the start of
+*   files. E_EDIT_INSERT segment occupy only 2nd file and E_EDIT_DELETE only
+*   1st file; other file position is the insertion point.
+*/
+typedef struct
+{
+    edit_type_e             type;
+    wavpos_t                pos[2];             //!< Segment start in 1st and 2nd file
+    wavpos_t                len;                //!< Segment length, samples
+    double                  d_sumSqr;           //!< Sum of squared difference (match and repeat only)
+    double                  r_sumSqr;           //!< Sum of squared reference (match and repeat only)
+    double                  d_abs_max;          //!< Max absolute difference (match and repeat only)
+} edit_segment_t;
+
+typedef struct edit_list_t edit_list_t;
+
+/**
+*   Build edit list for the rest of files, starting from current read
+*   positions. File positions are restored.
+*   @return edit list, or NULL if no memory
+*/
+edit_list_t * EDIT_build(
+    wav_file_t *            wf0,                //!< Reference file
+    wav_file_t *            wf1                 //!< Test file
+    );
+
+/**
+*   Release edit list
+*/
+void EDIT_free(
+    edit_list_t *           e                   //!< Edit list
+    );
+
+/**
+*   @return number of segments in the list
+*/
+size_t EDIT_count(
+    const edit_list_t *     e                   //!< Edit list
+    );
+
+/**
+*   @return i-th segment
+*/
+const edit_segment_t * EDIT_segment(
+    const edit_list_t *     e,                  //!< Edit list
+    size_t                  i                   //!< Segment index
+    );
+
+/**
+*   @return symbolic name of the segment type
+*/
+const TCHAR * EDIT_type_string(
+    edit_type_e             type
+    );
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif //editlist_H_INCLUDED
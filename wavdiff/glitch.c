@@ -0,0 +1,459 @@
+/** 18.10.2026 @file
+*   Streaming detector of dropouts and glitches in the test stream.
+*/
+#include "glitch.h"
+#include "wd.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Energy analysis window, milliseconds
+#define WINDOW_MS           10
+#define WINDOW_MIN          64
+
+// Difference power jump, which opens an event: 20 dB above baseline
+#define JUMP_RATIO          100.0
+
+// Difference power floor (-80 dB): ignore jumps from bit-exact baseline below this level
+#define POWER_FLOOR         1e-8
+
+// Number of consecutive windows to open or close energy jump event
+#define SUSTAIN_WINDOWS     5
+
+// Baseline averaging time constant: 2^BASELINE_LOG2 windows
+#define BASELINE_LOG2       6
+
+// Shortest reported run of zero samples
+#define ZERO_RUN_MIN        64
+
+// Shortest reported repeated block, samples
+#define REPEAT_WINDOW       64
+
+// Longest repeat distance: 2^REPEAT_LAG_LOG2 samples
+#define REPEAT_LAG_LOG2     16
+#define REPEAT_RING         (1u << (REPEAT_LAG_LOG2 + 1))
+#define REPEAT_HASH_LOG2    16
+
+// Events list limit
+#define MAX_EVENTS          4096
+
+#define HASH_INIT           0xcbf29ce484222325ull
+#define HASH_PRIME          0x100000001b3ull
+#define ROLL_BASE           0x9e3779b97f4a7c15ull
+
+#ifndef MAX
+#   define MAX(x,y)         ((x)>(y) ? (x):(y))
+#endif
+
+typedef struct
+{
+    uint64_t                hash;
+    wavpos_t                pos;
+} repeat_entry_t;
+
+struct glitch_detector_t
+{
+    unsigned int            nch;
+    wavpos_t                pos;                // current sample position
+
+    // Difference energy jump
+    size_t                  win_len;
+    size_t                  win_fill;
+    double                  win_power;
+    double                  baseline;
+    int                     is_baseline_set;
+    int                     jump_count;
+    int                     normal_count;
+    int                     in_jump;
+    wavpos_t                jump_start;
+    wavpos_t                normal_start;
+    double                  jump_peak;
+
+    // Zero runs
+    wavpos_t                zero_start;
+    wavpos_t                zero_len;
+    wavpos_t                zero_ref_active;
+
+    // Repeated blocks
+    uint64_t                roll_hash;
+    uint64_t                roll_base_pow;      // ROLL_BASE^REPEAT_WINDOW
+    wavpos_t                last_change;
+    int                     in_repeat;
+    wavpos_t                repeat_start;
+    wavpos_t                repeat_lag;
+    wavpos_t                repeat_len;
+    wavpos_t                repeat_ref_match;
+    uint64_t                *ring_test;
+    uint64_t                *ring_ref;
+    repeat_entry_t          *table;
+
+    // Detected events
+    glitch_event_t          *events;
+    size_t                  events_count;
+    size_t                  events_alloc;
+    size_t                  events_lost;
+};
+
+
+static void add_event(glitch_detector_t * g, const glitch_event_t * e)
+{
+    if (g->events_count == g->events_alloc)
+    {
+        size_t n = g->events_alloc ? g->events_alloc * 2 : 16;
+        glitch_event_t * p;
+        if (n > MAX_EVENTS || NULL == (p = realloc(g->events, n * sizeof(glitch_event_t))))
+        {
+            g->events_lost++;
+            return;
+        }
+        g->events = p;
+        g->events_alloc = n;
+    }
+    g->events[g->events_count++] = *e;
+}
+
+
+glitch_detector_t * GLITCH_alloc(unsigned int nch, unsigned long hz)
+{
+    int i;
+    glitch_detector_t * g = calloc(1, sizeof(glitch_detector_t));
+    if (!g)
+    {
+        return NULL;
+    }
+    g->nch = nch;
+    g->win_len = MAX((size_t)hz * WINDOW_MS / 1000, WINDOW_MIN);
+    g->ring_test = calloc(REPEAT_RING, sizeof(uint64_t));
+    g->ring_ref  = calloc(REPEAT_RING, sizeof(uint64_t));
+    g->table     = calloc((size_t)1 << REPEAT_HASH_LOG2, sizeof(repeat_entry_t));
+    if (!g->ring_test || !g->ring_ref || !g->table)
+    {
+        GLITCH_free(g);
+        return NULL;
+    }
+    for (i = 0; i < 1 << REPEAT_HASH_LOG2; i++)
+    {
+        g->table[i].pos = -1;
+    }
+    g->roll_base_pow = 1;
+    for (i = 0; i < REPEAT_WINDOW; i++)
+    {
+        g->roll_base_pow *= ROLL_BASE;
+    }
+    return g;
+}
+
+
+void GLITCH_free(glitch_detector_t * g)
+{
+    if (g)
+    {
+        free(g->ring_test);
+        free(g->ring_ref);
+        free(g->table);
+        free(g->events);
+        free(g);
+    }
+}
+
+
+/**
+*   Hash of the sample bit patterns over all channels
+*/
+static uint64_t sample_digest(const double * x, unsigned int nch)
+{
+    uint64_t h = HASH_INIT;
+    unsigned int c;
+    for (c = 0; c < nch; c++)
+    {
+        uint64_t u;
+        memcpy(&u, x + c, sizeof(u));
+        h = (h ^ u) * HASH_PRIME;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+
+static void close_jump(glitch_detector_t * g, wavpos_t end)
+{
+    glitch_event_t e;
+    memset(&e, 0, sizeof(e));
+    e.type = E_GLITCH_ENERGY_JUMP;
+    e.pos = g->jump_start;
+    e.len = end - g->jump_start;
+    e.peak_power = g->jump_peak;
+    e.base_power = g->is_baseline_set ? g->baseline : 0;
+    add_event(g, &e);
+    g->in_jump = 0;
+    g->jump_count = 0;
+    g->normal_count = 0;
+}
+
+
+/**
+*   Analyze difference power of the complete window
+*/
+static void window_done(glitch_detector_t * g)
+{
+    wavpos_t win_start = g->pos + 1 - g->win_len;
+    double power = g->win_power / (g->win_len * g->nch);
+    double threshold = MAX(g->baseline * JUMP_RATIO, POWER_FLOOR);
+
+    g->win_power = 0;
+    g->win_fill = 0;
+
+    if (!g->is_baseline_set)
+    {
+        // Take first window as a baseline
+        g->baseline = power;
+        g->is_baseline_set = 1;
+    }
+    else if (power > threshold)
+    {
+        if (!g->jump_count)
+        {
+            g->jump_start = win_start;
+            g->jump_peak = 0;
+        }
+        g->jump_count++;
+        g->jump_peak = MAX(g->jump_peak, power);
+        g->normal_count = 0;
+        if (g->jump_count >= SUSTAIN_WINDOWS)
+        {
+            g->in_jump = 1;
+        }
+    }
+    else if (g->in_jump)
+    {
+        if (!g->normal_count++)
+        {
+            g->normal_start = win_start;
+        }
+        if (g->normal_count >= SUSTAIN_WINDOWS)
+        {
+            close_jump(g, g->normal_start);
+        }
+    }
+    else
+    {
+        // Short bursts are not reported and do not affect baseline
+        g->jump_count = 0;
+        g->baseline += (power - g->baseline) / (1 << BASELINE_LOG2);
+    }
+}
+
+
+static void close_zero_run(glitch_detector_t * g)
+{
+    if (g->zero_len >= ZERO_RUN_MIN && g->zero_ref_active * 2 >= g->zero_len)
+    {
+        glitch_event_t e;
+        memset(&e, 0, sizeof(e));
+        e.type = E_GLITCH_ZERO_RUN;
+        e.pos = g->zero_start;
+        e.len = g->zero_len;
+        add_event(g, &e);
+    }
+    g->zero_len = 0;
+    g->zero_ref_active = 0;
+}
+
+
+static void close_repeat(glitch_detector_t * g)
+{
+    // Repeat is legal, if reference repeats itself in the same way
+    if (g->repeat_ref_match < g->repeat_len)
+    {
+        glitch_event_t e;
+        memset(&e, 0, sizeof(e));
+        e.type = E_GLITCH_REPEAT;
+        e.pos = g->repeat_start;
+        e.len = g->repeat_len;
+        e.lag = g->repeat_lag;
+        add_event(g, &e);
+    }
+    g->in_repeat = 0;
+}
+
+
+/**
+*   Look for the window of REPEAT_WINDOW samples ending at current position
+*   in the recent past of the test stream
+*/
+static void find_repeat(glitch_detector_t * g)
+{
+    wavpos_t n = g->pos;
+    repeat_entry_t * entry = g->table + (size_t)(g->roll_hash >> (64 - REPEAT_HASH_LOG2));
+
+    // Ignore constant signal (including silence)
+    if (n + 1 >= REPEAT_WINDOW && g->last_change > n + 1 - REPEAT_WINDOW)
+    {
+        wavpos_t lag = n - entry->pos;
+        if (entry->pos >= 0 && entry->hash == g->roll_hash && lag <= (1 << REPEAT_LAG_LOG2))
+        {
+            int i;
+            wavpos_t ref_match = 0;
+            for (i = 0; i < REPEAT_WINDOW; i++)
+            {
+                size_t k0 = (size_t)(n - i) & (REPEAT_RING - 1);
+                size_t k1 = (size_t)(n - lag - i) & (REPEAT_RING - 1);
+                if (g->ring_test[k0] != g->ring_test[k1])
+                {
+                    break;
+                }
+                ref_match += g->ring_ref[k0] == g->ring_ref[k1];
+            }
+            if (i == REPEAT_WINDOW)
+            {
+                g->in_repeat = 1;
+                g->repeat_start = n + 1 - REPEAT_WINDOW;
+                g->repeat_len = REPEAT_WINDOW;
+                g->repeat_lag = lag;
+                g->repeat_ref_match = ref_match;
+            }
+        }
+    }
+    entry->hash = g->roll_hash;
+    entry->pos = n;
+}
+
+
+void GLITCH_process(glitch_detector_t * g, const double * ref, const double * test, size_t nsamples)
+{
+    size_t i;
+    unsigned int c;
+    for (i = 0; i < nsamples; i++, ref += g->nch, test += g->nch, g->pos++)
+    {
+        int is_test_zero = 1;
+        int is_ref_zero = 1;
+        uint64_t dig_test, dig_ref;
+        size_t k = (size_t)g->pos & (REPEAT_RING - 1);
+        double power = 0;
+
+        for (c = 0; c < g->nch; c++)
+        {
+            double d = test[c] - ref[c];
+            power += d * d;
+            is_test_zero &= test[c] == 0;
+            is_ref_zero &= ref[c] == 0;
+        }
+
+        //
+        // Difference energy
+        //
+        g->win_power += power;
+        if (++g->win_fill == g->win_len)
+        {
+            window_done(g);
+        }
+
+        //
+        // Zero runs
+        //
+        if (is_test_zero)
+        {
+            if (!g->zero_len++)
+            {
+                g->zero_start = g->pos;
+            }
+            g->zero_ref_active += !is_ref_zero;
+        }
+        else if (g->zero_len)
+        {
+            close_zero_run(g);
+        }
+
+        //
+        // Repeated blocks
+        //
+        dig_test = sample_digest(test, g->nch);
+        dig_ref = sample_digest(ref, g->nch);
+        if (!g->pos || dig_test != g->ring_test[(k - 1) & (REPEAT_RING - 1)])
+        {
+            g->last_change = g->pos;
+        }
+        g->roll_hash = g->roll_hash * ROLL_BASE + dig_test;
+        if (g->pos >= REPEAT_WINDOW)
+        {
+            g->roll_hash -= g->ring_test[(k - REPEAT_WINDOW) & (REPEAT_RING - 1)] * g->roll_base_pow;
+        }
+        g->ring_test[k] = dig_test;
+        g->ring_ref[k] = dig_ref;
+
+        if (g->in_repeat)
+        {
+            size_t kl = (size_t)(g->pos - g->repeat_lag) & (REPEAT_RING - 1);
+            if (dig_test == g->ring_test[kl])
+            {
+                g->repeat_len++;
+                g->repeat_ref_match += dig_ref == g->ring_ref[kl];
+            }
+            else
+            {
+                close_repeat(g);
+            }
+        }
+        if (!g->in_repeat)
+        {
+            find_repeat(g);
+        }
+    }
+}
+
+
+static int compare_events_pos(const void * a, const void * b)
+{
+    wavpos_t pa = ((const glitch_event_t *)a)->pos;
+    wavpos_t pb = ((const glitch_event_t *)b)->pos;
+    return pa < pb ? -1 : pa > pb;
+}
+
+
+void GLITCH_flush(glitch_detector_t * g)
+{
+    if (g->in_jump)
+    {
+        close_jump(g, g->normal_count ? g->normal_start : g->pos);
+    }
+    if (g->zero_len)
+    {
+        close_zero_run(g);
+    }
+    if (g->in_repeat)
+    {
+        close_repeat(g);
+    }
+
+    // Energy jump events are closed with delay: sort events by position
+    qsort(g->events, g->events_count, sizeof(glitch_event_t), compare_events_pos);
+}
+
+
+size_t GLITCH_events_count(const glitch_detector_t * g)
+{
+    return g->events_count;
+}
+
+
+size_t GLITCH_events_lost(const glitch_detector_t * g)
+{
+    return g->events_lost;
+}
+
+
+const glitch_event_t * GLITCH_event(const glitch_detector_t * g, size_t i)
+{
+    return i < g->events_count ? g->events + i : NULL;
+}
+
+
+const TCHAR * GLITCH_type_string(glitch_type_e type)
+{
+    switch (type)
+    {
+    case E_GLITCH_ENERGY_JUMP:  return _T("Error jump");
+    case E_GLITCH_ZERO_RUN:     return _T("Zero run  ");
+    case E_GLITCH_REPEAT:       return _T("Repeat    ");
+    }
+    return _T("?");
+}
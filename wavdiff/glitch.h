@@ -0,0 +1,122 @@
+/** 18.10.2026 @file
+*   Streaming detector of dropouts and glitches in the test stream.
+*
+*   Runs alongside difference statistic gathering and flags:
+*   - sudden sustained jumps of the difference energy (dropout, desync)
+*   - runs of digital zero in the test stream, where reference is not silent
+*   - blocks of the test stream, repeated from the recent past
+*
+*   Example:
+*
+*   glitch_detector_t * g = GLITCH_alloc(nch, hz);
+*   while (...)
+*   {
+*       GLITCH_process(g, ref, test, nsamples);
+*   }
+*   GLITCH_flush(g);
+*   for (i = 0; i < GLITCH_events_count(g); i++) print(GLITCH_event(g, i));
+*   GLITCH_free(g);
+*/
+
+#ifndef glitch_H_INCLUDED
+#define glitch_H_INCLUDED
+
+#include "f_wav_io.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  //__cplusplus
+
+/**
+*   Glitch type
+*/
+typedef enum
+{
+    E_GLITCH_ENERGY_JUMP = 0,               //!< Sustained difference energy jump
+    E_GLITCH_ZERO_RUN,                      //!< Run of zero samples in the test stream
+    E_GLITCH_REPEAT                         //!< Repeated block in the test stream
+} glitch_type_e;
+
+/**
+*   Glitch event descriptor. Positions are given in samples, counted
+*   from the start of comparison.
+*/
+typedef struct
+{
+    glitch_type_e           type;
+    wavpos_t                pos;                //!< First sample of the event
+    wavpos_t                len;                //!< Event duration, samples
+    wavpos_t                lag;                //!< Repeat distance, samples (E_GLITCH_REPEAT only)
+    double                  peak_power;         //!< Peak difference power (E_GLITCH_ENERGY_JUMP only)
+    double                  base_power;         //!< Difference power before the jump (E_GLITCH_ENERGY_JUMP only)
+} glitch_event_t;
+
+typedef struct glitch_detector_t glitch_detector_t;
+
+/**
+*   Create detector for interleaved streams with given number of channels
+*   @return detector handle, or NULL if no memory
+*/
+glitch_detector_t * GLITCH_alloc(
+    unsigned int            nch,                //!< Number of channels
+    unsigned long           hz                  //!< Sample rate (0 if unknown)
+    );
+
+/**
+*   Release detector
+*/
+void GLITCH_free(
+    glitch_detector_t *     g                   //!< Detector handle
+    );
+
+/**
+*   Process block of interleaved reference and test samples
+*/
+void GLITCH_process(
+    glitch_detector_t *     g,                  //!< Detector handle
+    const double *          ref,                //!< [IN] Reference samples
+    const double *          test,               //!< [IN] Test samples
+    size_t                  nsamples            //!< Number of samples (sample = nch values)
+    );
+
+/**
+*   Close events, which are still open at the end of stream
+*/
+void GLITCH_flush(
+    glitch_detector_t *     g                   //!< Detector handle
+    );
+
+/**
+*   @return number of detected events
+*/
+size_t GLITCH_events_count(
+    const glitch_detector_t * g                 //!< Detector handle
+    );
+
+/**
+*   @return number of events, detected but not stored due to list size limit
+*/
+size_t GLITCH_events_lost(
+    const glitch_detector_t * g                 //!< Detector handle
+    );
+
+/**
+*   @return i-th event descriptor
+*/
+const glitch_event_t * GLITCH_event(
+    const glitch_detector_t * g,                //!< Detector handle
+    size_t                  i                   //!< Event index
+    );
+
+/**
+*   @return symbolic name of the glitch type
+*/
+const TCHAR * GLITCH_type_string(
+    glitch_type_e           type
+    );
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif //glitch_H_INCLUDED
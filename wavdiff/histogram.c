@@ -0,0 +1,235 @@
+/** 18.10.2026 @file
+*   Sparse adaptive histogram of integer sample codes.
+*/
+#include "histogram.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+// Initial hash table size, log2
+#define HIST_INIT_BITS      10
+
+// Max number of code bits
+#define HIST_CODE_BITS      32
+
+#define MIN( x, y )         ( (x)<(y)?(x):(y) )
+
+typedef struct
+{
+    unsigned long           code;
+    hist_count_t            count;              //!< 0 for empty slot
+} hist_entry_t;
+
+struct hist_t
+{
+    hist_entry_t *          table;
+    unsigned long           size;               //!< Table size
+    unsigned int            bits;               //!< Table size, log2
+    unsigned long           used;               //!< Number of distinct codes
+    unsigned long           max_entries;
+    unsigned int            shift;              //!< Resolution reduction, bits
+    int                     failed;             //!< No memory: counting stopped
+};
+
+
+static hist_entry_t * find_slot(hist_entry_t * table, unsigned int bits, unsigned long code)
+{
+    unsigned long mask = (1UL << bits) - 1;
+    // Fibonacci hashing: table index is taken from high bits of the product
+    unsigned long i = ((code * 2654435761UL) & 0xFFFFFFFFUL) >> (HIST_CODE_BITS - bits);
+    while (table[i].count && table[i].code != code)
+    {
+        i = (i + 1) & mask;
+    }
+    return table + i;
+}
+
+
+/**
+*   Rebuild table with given size, dropping shift low bits from codes
+*   @return 0 if no memory
+*/
+static int rebuild(hist_t * h, unsigned int bits, unsigned int shift)
+{
+    unsigned long i;
+    hist_entry_t * table = calloc(1UL << bits, sizeof(hist_entry_t));
+    if (!table)
+    {
+        return 0;
+    }
+    h->used = 0;
+    for (i = 0; i < h->size; i++)
+    {
+        const hist_entry_t * e = h->table + i;
+        if (e->count)
+        {
+            unsigned long code = shift < HIST_CODE_BITS ? e->code >> shift : 0;
+            hist_entry_t * s = find_slot(table, bits, code);
+            if (!s->count)
+            {
+                s->code = code;
+                h->used++;
+            }
+            s->count += e->count;
+        }
+    }
+    free(h->table);
+    h->table = table;
+    h->bits = bits;
+    h->size = 1UL << bits;
+    h->shift += shift;
+    return 1;
+}
+
+
+/**
+*   Called when new code was added: keep table load factor below 1/2 by
+*   growing the table, or reduce resolution, if number of distinct codes
+*   exceeds the limit.
+*/
+static void fit(hist_t * h)
+{
+    if (h->used <= h->size / 2 && h->used <= h->max_entries)
+    {
+        return;
+    }
+    if (h->used <= h->max_entries && h->bits < HIST_CODE_BITS - 1 && rebuild(h, h->bits + 1, 0))
+    {
+        return;
+    }
+    while (h->used > h->max_entries / 2 && h->shift < HIST_CODE_BITS && !h->failed)
+    {
+        h->failed = !rebuild(h, h->bits, 1);
+    }
+    h->failed |= h->used > h->size / 2;
+}
+
+
+hist_t * HIST_create(unsigned long max_entries)
+{
+    hist_t * h = calloc(1, sizeof(hist_t));
+    if (!h)
+    {
+        return NULL;
+    }
+    h->max_entries = max_entries;
+    h->bits = HIST_INIT_BITS;
+    h->size = 1UL << h->bits;
+    h->table = calloc(h->size, sizeof(hist_entry_t));
+    if (!h->table)
+    {
+        free(h);
+        return NULL;
+    }
+    return h;
+}
+
+
+void HIST_free(hist_t * h)
+{
+    if (h)
+    {
+        free(h->table);
+        free(h);
+    }
+}
+
+
+void HIST_add(hist_t * h, unsigned long code)
+{
+    hist_entry_t * e;
+    if (h->failed)
+    {
+        return;
+    }
+    code = h->shift < HIST_CODE_BITS ? (code & 0xFFFFFFFFUL) >> h->shift : 0;
+    e = find_slot(h->table, h->bits, code);
+    if (!e->count)
+    {
+        e->code = code;
+        e->count = 1;
+        h->used++;
+        fit(h);
+        return;
+    }
+    e->count++;
+}
+
+
+void HIST_merge(hist_t * dst, const hist_t * src)
+{
+    unsigned long i;
+    unsigned int shift;
+    if (dst->shift < src->shift && !dst->failed)
+    {
+        dst->failed = !rebuild(dst, dst->bits, src->shift - dst->shift);
+    }
+    dst->failed |= src->failed;
+    if (!dst->failed)
+    {
+        // Pre-size the table: inserting codes in the order of src table slots
+        // into a small table leads to long probe sequences
+        unsigned int bits = dst->bits;
+        unsigned long used = MIN(dst->used + src->used, dst->max_entries);
+        while (used > (1UL << bits) / 2 && bits < HIST_CODE_BITS - 1)
+        {
+            bits++;
+        }
+        if (bits != dst->bits)
+        {
+            rebuild(dst, bits, 0);
+        }
+    }
+    for (i = 0; i < src->size && !dst->failed; i++)
+    {
+        const hist_entry_t * e = src->table + i;
+        if (e->count)
+        {
+            hist_entry_t * s;
+            unsigned long code = e->code;
+            shift = dst->shift - src->shift;
+            code = shift < HIST_CODE_BITS ? code >> shift : 0;
+            s = find_slot(dst->table, dst->bits, code);
+            if (!s->count)
+            {
+                s->code = code;
+                s->count = e->count;
+                dst->used++;
+                fit(dst);
+                continue;
+            }
+            s->count += e->count;
+        }
+    }
+}
+
+
+double HIST_entropy(const hist_t * h)
+{
+    unsigned long i;
+    double total = 0;
+    double entropy = 0;
+    if (h->failed)
+    {
+        return -1;
+    }
+    for (i = 0; i < h->size; i++)
+    {
+        total += (double)h->table[i].count;
+    }
+    for (i = 0; i < h->size && total > 0; i++)
+    {
+        double prob = (double)h->table[i].count / total;
+        if (prob > 0)
+        {
+            entropy -= prob * log(prob);
+        }
+    }
+    return entropy / log(2.);
+}
+
+
+unsigned int HIST_shift(const hist_t * h)
+{
+    return h->shift;
+}
@@ -0,0 +1,84 @@
+/** 18.10.2026 @file
+*   Sparse adaptive histogram of integer sample codes.
+*
+*   Counts are kept in open-addressing hash table, so memory is proportional
+*   to the number of distinct values. When the number of distinct values
+*   exceeds the limit, histogram resolution is reduced: codes are shifted
+*   right by one bit and equal codes merged. Histograms, gathered by
+*   different threads, may be merged.
+*
+*   Example:
+*
+*   hist_t * h = HIST_create(1 << 20);
+*   for (i = 0; i < n; i++) HIST_add(h, code[i]);
+*   printf("%f bits at %d bits resolution", HIST_entropy(h), 32 - HIST_shift(h));
+*   HIST_free(h);
+*/
+
+#ifndef histogram_H_INCLUDED
+#define histogram_H_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif  //__cplusplus
+
+#if defined (_MSC_VER)
+typedef unsigned __int64 hist_count_t;
+#else
+typedef unsigned long long hist_count_t;
+#endif
+
+typedef struct hist_t hist_t;
+
+/**
+*   Create empty histogram
+*   @return histogram handle, or NULL if no memory
+*/
+hist_t * HIST_create(
+    unsigned long           max_entries         //!< Max number of distinct codes
+    );
+
+/**
+*   Release histogram
+*/
+void HIST_free(
+    hist_t *                h                   //!< Histogram handle
+    );
+
+/**
+*   Count code occurrence
+*/
+void HIST_add(
+    hist_t *                h,                  //!< Histogram handle
+    unsigned long           code                //!< Sample code (32 bits)
+    );
+
+/**
+*   Add counts of src histogram to dst. Resolution of the result is the
+*   lowest of two.
+*/
+void HIST_merge(
+    hist_t *                dst,                //!< Histogram handle
+    const hist_t *          src                 //!< Histogram to add
+    );
+
+/**
+*   @return entropy, bits per code, or -1 if histogram is incomplete due to
+*   memory allocation failure
+*/
+double HIST_entropy(
+    const hist_t *          h                   //!< Histogram handle
+    );
+
+/**
+*   @return number of low bits, dropped from codes due to resolution reduction
+*/
+unsigned int HIST_shift(
+    const hist_t *          h                   //!< Histogram handle
+    );
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif //histogram_H_INCLUDED
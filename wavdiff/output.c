@@ -1,6 +1,7 @@
 #include "output.h"
 #include "sys_gauge.h"
 #include "sys_dirlist.h"
+#include "f_wav_align.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -223,6 +224,22 @@ void print_totals(summary_stat_t * tot, FILE * hfile)
     {
         _ftprintf(hfile, _T("; %u files differs"), tot->files_differs);
     }
+    if (tot->files_with_glitches)
+    {
+        _ftprintf(hfile, _T("; %u files with glitches"), tot->files_with_glitches);
+    }
+    if (tot->files_resynced)
+    {
+        _ftprintf(hfile, _T("; %u files re-aligned"), tot->files_resynced);
+    }
+    if (tot->files_edited)
+    {
+        _ftprintf(hfile, _T("; %u files with edits"), tot->files_edited);
+    }
+    if (tot->files_out_of_tol)
+    {
+        _ftprintf(hfile, _T("; %u files out of tolerance"), tot->files_out_of_tol);
+    }
     if (tot->total_samples_count)
     {
         _ftprintf(hfile, _T("\nAverage PSNR square wave,    dB : %s"),
@@ -390,7 +407,7 @@ static double my_div(double x, double y)
 */
 void OUTPUT_print_file_stat (wav_file_t * wf[2], file_stat_t * diff, cmdline_options_t * opt)
 {
-    unsigned int i;
+    unsigned int i, k;
     double  dblPCMscale;
     static TCHAR s[4096];
     TCHAR *  p;
@@ -403,15 +420,7 @@ void OUTPUT_print_file_stat (wav_file_t * wf[2], file_stat_t * diff, cmdline_opt
     double tot_samples = nch * n_samples;
     int have_offset = OffsetInfoHaveOffset(diff, opt);
 
-    int stat_bips = MIN(labs(wf[0]->fmt.bips), labs(wf[1]->fmt.bips));
-    if (wf[0]->fmt.pcm_type == E_PCM_IEEE_FLOAT)
-    {
-        stat_bips = wf[1]->fmt.pcm_type == E_PCM_IEEE_FLOAT ? 16 : labs(wf[1]->fmt.bips);
-    }
-    if (wf[1]->fmt.pcm_type == E_PCM_IEEE_FLOAT)
-    {
-        stat_bips = wf[0]->fmt.pcm_type == E_PCM_IEEE_FLOAT ? 16 : labs(wf[0]->fmt.bips);
-    }
+    int stat_bips = diff_stat_bips(wf);
     dblPCMscale = ldexp(1, stat_bips - 1);
     if (opt->listing == E_LISTING_SHORT || (opt->listing == E_LISTING_NO_BITEXACT && (tot->d_sumSqr != 0 || have_offset)))
     {
@@ -518,6 +527,34 @@ void OUTPUT_print_file_stat (wav_file_t * wf[2], file_stat_t * diff, cmdline_opt
         {
             FIX_ANCHORS(5)
         }
+        if (diff->drift_ppm)
+        {
+            p += _stprintf(p, _T(" Drift:%+.2fppm"), diff->drift_ppm);
+        }
+        if (diff->delay)
+        {
+            p += _stprintf(p, _T(" Delay:%+.3f"), diff->delay);
+        }
+        if (diff->align_psr > 0 && diff->align_psr < ALIGN_PSR_MIN)
+        {
+            p += _stprintf(p, _T(" PSR:%.1f"), diff->align_psr);
+        }
+        if (diff->ch_shift_max)
+        {
+            p += _stprintf(p, _T(" ChOffsets:"));
+            for (i = 0; i < diff->nch; i++)
+            {
+                p += _stprintf(p, i ? _T(",%ld") : _T("%ld"), diff->ch_offset[i]);
+            }
+        }
+        for (i = 0; i < diff->lsb_thr_count; i++)
+        {
+            p += _stprintf(p, _T(" >%gLSB:%") _T(PRIu64), opt->lsb_thr[i], tot->lsb_over[i]);
+        }
+        if (opt->tol_flag)
+        {
+            p += _stprintf(p, _T(" Tol:%s"), diff->tol_failed ? _T("FAIL") : _T("PASS"));
+        }
         
         while ((p - s) % 16)
         {
@@ -599,6 +636,29 @@ void OUTPUT_print_file_stat (wav_file_t * wf[2], file_stat_t * diff, cmdline_opt
                 my_printf(_T("%s\n"), s); 
             }
         }
+        if (diff->align_psr > 0)
+        {
+            my_printf(_T("Alignment confidence: peak-to-sidelobe ratio %.1f%s\n"), diff->align_psr,
+                      diff->align_psr < ALIGN_PSR_MIN ? _T(", offset may be wrong.") : _T("."));
+        }
+        if (diff->drift_ppm)
+        {
+            my_printf(_T("Clock drift: %+.3f ppm, compensated by resampling 2nd file.\n"), diff->drift_ppm);
+        }
+        if (diff->delay)
+        {
+            my_printf(_T("Delay: %+.3f samples, compensated by resampling 2nd file.\n"), diff->delay);
+        }
+        if (diff->ch_shift_max)
+        {
+            p = s;
+            p += _stprintf(p, _T("Channel offsets:"));
+            for (i = 0; i < diff->nch; i++)
+            {
+                p += _stprintf(p, _T(" %ld"), diff->ch_offset[i]);
+            }
+            my_printf(_T("%s samples, compensated separately.\n"), s);
+        }
 
         p = s;
         p += _stprintf(p, _T("                        Total          |"));
@@ -683,6 +743,168 @@ void OUTPUT_print_file_stat (wav_file_t * wf[2], file_stat_t * diff, cmdline_opt
             p += _stprintf(p, _T("%-15s"), print_float(sqrt(my_div(ch[i].t_sumSqr, ch[i].r_sumSqr)), 11, 6));
         }
         my_printf(_T("%s\n"), s); p = s;
+
+        for (k = 0; k < diff->lsb_thr_count; k++)
+        {
+            TCHAR label[FIELDW];
+            _sntprintf(label, FIELDW, _T("Samples > %g LSB:"), opt->lsb_thr[k]);
+            p += _stprintf(p, _T("%-24s%-15") _T(PRIu64) _T("|"), label, tot->lsb_over[k]);
+            if (nch != 1) for (i = 0; i < nch; i++)
+            {
+                p += _stprintf(p, _T("%-15") _T(PRIu64), ch[i].lsb_over[k]);
+            }
+            my_printf(_T("%s\n"), s); p = s;
+        }
+        if (opt->tol_flag)
+        {
+            p += _stprintf(p, _T("Tolerance: %s (|diff| <= %g LSB"), diff->tol_failed ? _T("FAIL") : _T("PASS"), opt->tol_lsb);
+            if (opt->tol_count)
+            {
+                p += _stprintf(p, _T(", fewer than %") _T(PRIi64) _T(" samples differ"), opt->tol_count);
+            }
+            my_printf(_T("%s)\n"), s); p = s;
+        }
+    }
+}
+
+/**
+*   Print sample position as time: [h:]mm:ss.mmm
+*/
+static TCHAR * print_time(wavpos_t pos, unsigned long hz)
+{
+    static int idx;
+    static TCHAR buf[4][FIELDW]; // up to 4 simultaneous numbers
+    TCHAR *p = buf[idx = (idx+1)&3];
+    if (!hz)
+    {
+        _sntprintf(p, FIELDW, _T("?"));
+    }
+    else
+    {
+        double sec = (double)pos / hz;
+        int h = (int)(sec / 3600);
+        int m = (int)(sec / 60) % 60;
+        sec -= 60. * (int)(sec / 60);
+        if (h)
+        {
+            _sntprintf(p, FIELDW, _T("%d:%02d:%06.3f"), h, m, sec);
+        }
+        else
+        {
+            _sntprintf(p, FIELDW, _T("%02d:%06.3f"), m, sec);
+        }
+    }
+    return p;
+}
+
+/**
+*   Dropouts and glitches report
+*/
+void OUTPUT_print_glitches(wav_file_t * wf[2], file_stat_t * diff, cmdline_options_t * opt)
+{
+    size_t i, count = GLITCH_events_count(diff->glitch);
+    static TCHAR s[4096];
+    TCHAR * p;
+    unsigned long hz = wf[1]->fmt.hz;
+
+    if (opt->listing == E_LISTING_LONG)
+    {
+        my_printf(_T("Glitches detected: %u\n"), (unsigned)count);
+    }
+    for (i = 0; i < count; i++)
+    {
+        const glitch_event_t * e = GLITCH_event(diff->glitch, i);
+        wavpos_t pos = e->pos + diff->actualOffsetSamples[1];
+        p = s;
+        p += _stprintf(p, _T("  %s at %") _T(PRIi64) _T(" (%s) for %") _T(PRIi64) _T(" smp"),
+            GLITCH_type_string(e->type), (int64_t)pos, print_time(pos, hz), (int64_t)e->len);
+        switch (e->type)
+        {
+        case E_GLITCH_ENERGY_JUMP:
+            p += _stprintf(p, _T(", %.1f dB"), 10 * log10(e->peak_power));
+            if (e->base_power)
+            {
+                p += _stprintf(p, _T(" after %.1f dB"), 10 * log10(e->base_power));
+            }
+            else
+            {
+                p += _stprintf(p, _T(" after MATCH"));
+            }
+            break;
+        case E_GLITCH_REPEAT:
+            p += _stprintf(p, _T(", %") _T(PRIi64) _T(" smp back"), (int64_t)e->lag);
+            break;
+        default:
+            break;
+        }
+        my_printf(_T("%s\n"), s);
+    }
+    if (GLITCH_events_lost(diff->glitch))
+    {
+        my_printf(_T("  ... %u more glitches not listed\n"), (unsigned)GLITCH_events_lost(diff->glitch));
+    }
+}
+
+
+/**
+*   Print edit list: one line per segment
+*/
+void OUTPUT_print_edits(wav_file_t * wf[2], const edit_list_t * edits, cmdline_options_t * opt)
+{
+    size_t i, count = EDIT_count(edits);
+    static TCHAR s[4096];
+    TCHAR * p;
+    unsigned long hz = wf[0]->fmt.hz;
+    unsigned int nch = wf[0]->fmt.ch;
+
+    if (opt->listing == E_LISTING_LONG)
+    {
+        print_name_long(_T("\nEdit list "), wf[0],  opt->file_name[0]);
+        print_name_long(_T("  ->      "), wf[1],  opt->file_name[1]);
+    }
+    else
+    {
+        my_printf(_T("Edit list %s -> %s\n"), 
+            PATH_after_last_separator(opt->file_name[0]), 
+            PATH_after_last_separator(opt->file_name[1]));
+    }
+    for (i = 0; i < count; i++)
+    {
+        const edit_segment_t * e = EDIT_segment(edits, i);
+        p = s;
+        p += _stprintf(p, _T("  %s 1st:%-10") _T(PRIi64) _T(" 2nd:%-10") _T(PRIi64) _T(" %9") _T(PRIi64) _T(" smp (%s)"),
+            EDIT_type_string(e->type), (int64_t)e->pos[0], (int64_t)e->pos[1], (int64_t)e->len, print_time(e->len, hz));
+        if (e->type == E_EDIT_MATCH || e->type == E_EDIT_REPEAT)
+        {
+            p += _stprintf(p, _T(" PSNR %s"), DB(e->d_sumSqr, (double)e->len * nch));
+        }
+        my_printf(_T("%s\n"), s);
+    }
+}
+
+
+/**
+*   Print re-alignment events
+*/
+void OUTPUT_print_resyncs(wav_file_t * wf[2], file_stat_t * diff, cmdline_options_t * opt)
+{
+    unsigned int i;
+    unsigned long hz = wf[0]->fmt.hz;
+
+    if (opt->listing == E_LISTING_LONG)
+    {
+        my_printf(_T("Re-alignments: %u, %lu samples skipped from 1st file, %lu from 2nd file\n"), 
+            diff->resync_count, diff->resync_skipped[0], diff->resync_skipped[1]);
+    }
+    for (i = 0; i < MIN(diff->resync_count, MAX_RESYNC_EVENTS); i++)
+    {
+        const resync_event_t * e = diff->resync + i;
+        my_printf(_T("  Resync at %") _T(PRIi64) _T(" (%s): %lu smp skipped from 1st, %lu from 2nd\n"),
+            (int64_t)e->pos, print_time(e->pos, hz), e->skipped[0], e->skipped[1]);
+    }
+    if (diff->resync_count > MAX_RESYNC_EVENTS)
+    {
+        my_printf(_T("  ... %u more re-alignments not listed\n"), diff->resync_count - MAX_RESYNC_EVENTS);
     }
 }
 
@@ -751,6 +973,31 @@ void OUTPUT_showStat(TFileInfo* nfo)
 #endif
     my_printf(_T("Entropy      Q7:        %.2f bits per sample (8-bit quantizer)\n"), nfo->entropy256);
     my_printf(_T("Entropy     Q15:        %.2f bits per sample (16-bit quantizer)\n"), nfo->entropy64k);
+    if (nfo->has_hist_q23)
+    {
+        // Resolution may be reduced, if there are too many distinct values
+        my_printf(_T("Entropy     Q%2u:        "), 23 - nfo->shift_q23);
+        if (nfo->entropy_q23 < 0)
+        {
+            my_printf(_T("n/a (not enough memory)\n"));
+        }
+        else
+        {
+            my_printf(_T("%.2f bits per sample (%u-bit quantizer)\n"), nfo->entropy_q23, 24 - nfo->shift_q23);
+        }
+    }
+    if (nfo->has_hist_float)
+    {
+        my_printf(_T("Entropy   float:        "));
+        if (nfo->entropy_float < 0)
+        {
+            my_printf(_T("n/a (not enough memory)\n"));
+        }
+        else
+        {
+            my_printf(_T("%.2f bits per sample (%u of 32 bits of float value)\n"), nfo->entropy_float, 32 - nfo->shift_float);
+        }
+    }
     my_printf(_T("Used bits mask : %08X\n"), nfo->usedBits32);
     
 }
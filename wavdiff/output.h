@@ -43,6 +43,24 @@ void OUTPUT_print_file_stat (
     cmdline_options_t * opt
     );
 
+void OUTPUT_print_glitches (
+    wav_file_t * wf[2], 
+    file_stat_t * diff, 
+    cmdline_options_t * opt
+    );
+
+void OUTPUT_print_resyncs (
+    wav_file_t * wf[2], 
+    file_stat_t * diff, 
+    cmdline_options_t * opt
+    );
+
+void OUTPUT_print_edits (
+    wav_file_t * wf[2], 
+    const edit_list_t * edits, 
+    cmdline_options_t * opt
+    );
+
 void OUTPUT_showStat(
     TFileInfo* pInfo
     );
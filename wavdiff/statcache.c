@@ -0,0 +1,379 @@
+/** 18.10.2026 @file
+*   On-disk cache of file pair comparison results.
+*/
+#include "statcache.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define CACHE_MAGIC         "WDCACHE2"
+#define HASH_INIT           0xcbf29ce484222325ull
+#define HASH_PRIME          0x100000001b3ull
+#define HASH_BLOCK          65536
+#define HASH_FIELD(h, x)    h = hash_bytes(h, &(x), sizeof(x))
+
+/**
+*   Cache file header. Records of other layout version or size are discarded.
+*/
+typedef struct
+{
+    char                    magic[8];
+    uint64_t                version;            //!< FILE_STAT_VERSION
+    uint64_t                record_size;
+} cache_header_t;
+
+typedef struct
+{
+    cache_key_t             key;
+    file_stat_t             stat;
+} cache_record_t;
+
+struct stat_cache_t
+{
+    FILE *                  file;               //!< Cache file, opened for append and locked by each access
+    cache_record_t *        rec;                //!< Loaded and added records, one per key
+    size_t                  count;
+    size_t                  size;
+    size_t *                index;              //!< Hash table of record numbers + 1 (0 - free slot)
+    size_t                  index_size;         //!< Power of 2, at least 2 * count
+};
+
+
+/**
+*   FNV-1a over 64-bit words, folded to spread high bits down
+*/
+static uint64_t hash_word(uint64_t h, uint64_t w)
+{
+    h = (h ^ w) * HASH_PRIME;
+    return h ^ (h >> 32);
+}
+
+
+static uint64_t hash_bytes(uint64_t h, const void * p, size_t n)
+{
+    const unsigned char * s = (const unsigned char *)p;
+    size_t i;
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        uint64_t w;
+        memcpy(&w, s + i, 8);
+        h = hash_word(h, w);
+    }
+    for (; i < n; i++)
+    {
+        h = (h ^ s[i]) * HASH_PRIME;
+    }
+    return h;
+}
+
+
+/**
+*   Hash whole file content. File position is restored.
+*   @return 0 if read error
+*/
+static int hash_file(wav_file_t * wf, uint64_t * hash, uint64_t * size)
+{
+    unsigned char buf[HASH_BLOCK];
+    FILE * f = wf->file;
+    wavpos_t initialPos = WAV_get_file_pos(wf);
+    size_t got;
+    int ok;
+    *hash = HASH_INIT;
+    *size = 0;
+    WAV_set_file_pos(wf, 0);
+    while ((got = fread(buf, 1, sizeof(buf), f)) > 0)
+    {
+        *hash = hash_bytes(*hash, buf, got);
+        *size += got;
+    }
+    ok = !ferror(f);
+    clearerr(f);
+    WAV_set_file_pos(wf, initialPos);
+    return ok;
+}
+
+
+/**
+*   Lock or unlock whole cache file. Lock waits for other process to
+*   release the file; concurrent wd runs may share the cache this way.
+*   @return 0 if failed
+*/
+#ifdef _WIN32
+static int lock_file(FILE * f, int lock)
+{
+    HANDLE h = (HANDLE)_get_osfhandle(_fileno(f));
+    OVERLAPPED o;
+    memset(&o, 0, sizeof(o));
+    if (lock)
+    {
+        return LockFileEx(h, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &o) != 0;
+    }
+    return UnlockFileEx(h, 0, MAXDWORD, MAXDWORD, &o) != 0;
+}
+
+static int truncate_file(FILE * f)
+{
+    return _chsize(_fileno(f), 0) == 0;
+}
+#else
+static int lock_file(FILE * f, int lock)
+{
+    struct flock fl;
+    int err;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = lock ? F_WRLCK : F_UNLCK;
+    fl.l_whence = SEEK_SET;
+    while ((err = fcntl(fileno(f), F_SETLKW, &fl)) != 0 && errno == EINTR)
+    {
+    }
+    return err == 0;
+}
+
+static int truncate_file(FILE * f)
+{
+    return ftruncate(fileno(f), 0) == 0;
+}
+#endif
+
+
+static int grow(stat_cache_t * c)
+{
+    size_t size = c->size ? c->size * 2 : 64;
+    cache_record_t * rec = realloc(c->rec, size * sizeof(cache_record_t));
+    if (!rec)
+    {
+        return 0;
+    }
+    c->rec = rec;
+    c->size = size;
+    return 1;
+}
+
+
+/**
+*   @return hash table slot of the key: holding its record, or free one
+*/
+static size_t * find_slot(const stat_cache_t * c, const cache_key_t * key)
+{
+    size_t mask = c->index_size - 1;
+    size_t i = (size_t)hash_bytes(HASH_INIT, key, sizeof(*key)) & mask;
+    while (c->index[i] && memcmp(&c->rec[c->index[i] - 1].key, key, sizeof(*key)))
+    {
+        i = (i + 1) & mask;
+    }
+    return c->index + i;
+}
+
+
+static int grow_index(stat_cache_t * c)
+{
+    size_t i, size = c->index_size ? c->index_size * 2 : 128;
+    size_t * index = calloc(size, sizeof(size_t));
+    if (!index)
+    {
+        return 0;
+    }
+    free(c->index);
+    c->index = index;
+    c->index_size = size;
+    for (i = 0; i < c->count; i++)
+    {
+        *find_slot(c, &c->rec[i].key) = i + 1;
+    }
+    return 1;
+}
+
+
+/**
+*   Add record, or replace the record with the same key
+*   @return 0 if no memory
+*/
+static int add_record(stat_cache_t * c, const cache_record_t * r, int * replaced)
+{
+    size_t * slot;
+    if ((c->count + 1) * 2 > c->index_size && !grow_index(c))
+    {
+        return 0;
+    }
+    slot = find_slot(c, &r->key);
+    *replaced = *slot != 0;
+    if (!*slot)
+    {
+        if (c->count == c->size && !grow(c))
+        {
+            return 0;
+        }
+        *slot = ++c->count;
+    }
+    c->rec[*slot - 1] = *r;
+    return 1;
+}
+
+
+stat_cache_t * CACHE_open(const TCHAR * path)
+{
+    cache_header_t hdr;
+    cache_record_t r;
+    stat_cache_t * c = calloc(1, sizeof(stat_cache_t));
+    FILE * f;
+    int append = 0, ok = 1;
+    if (!c)
+    {
+        return NULL;
+    }
+
+    // Never truncate on open: the cache may be in use by other process
+    f = c->file = _tfopen(path, _T("a+b"));
+    if (!f || !lock_file(f, 1))
+    {
+        CACHE_close(c);
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_SET);
+    if (fread(&hdr, sizeof(hdr), 1, f) == 1 &&
+        !memcmp(hdr.magic, CACHE_MAGIC, sizeof(hdr.magic)) &&
+        hdr.version == FILE_STAT_VERSION &&
+        hdr.record_size == sizeof(cache_record_t))
+    {
+        size_t got = 0;
+        int replaced;
+        append = 1;
+        while (ok && (got = fread(&r, 1, sizeof(r), f)) == sizeof(r))
+        {
+            // Latest record of the key wins: earlier ones are dropped by rewrite
+            ok = add_record(c, &r, &replaced);
+            append &= !replaced;
+        }
+        // Append only after complete records
+        append &= ok && !got;
+    }
+
+    if (!append)
+    {
+        // New, foreign, truncated or repeating keys cache: rewrite with records loaded
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, CACHE_MAGIC, sizeof(hdr.magic));
+        hdr.version = FILE_STAT_VERSION;
+        hdr.record_size = sizeof(cache_record_t);
+        fseek(f, 0, SEEK_SET);
+        ok = truncate_file(f) &&
+             fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+             fwrite(c->rec, sizeof(cache_record_t), c->count, f) == c->count &&
+             !fflush(f);
+    }
+    if (!lock_file(f, 0) || !ok)
+    {
+        CACHE_close(c);
+        return NULL;
+    }
+    return c;
+}
+
+
+void CACHE_close(stat_cache_t * c)
+{
+    if (c)
+    {
+        if (c->file)
+        {
+            fclose(c->file);
+        }
+        free(c->rec);
+        free(c->index);
+        free(c);
+    }
+}
+
+
+int CACHE_make_key(cache_key_t * key, wav_file_t * wf[2], const cmdline_options_t * opt)
+{
+    int i;
+    uint64_t h = HASH_INIT;
+    memset(key, 0, sizeof(*key));
+    for (i = 0; i < 2; i++)
+    {
+        if (!hash_file(wf[i], &key->hash[i], &key->size[i]))
+        {
+            return 0;
+        }
+    }
+
+    // Options, which change alignment or statistic
+    HASH_FIELD(h, opt->offset_bytes);
+    HASH_FIELD(h, opt->offsetSamples);
+    HASH_FIELD(h, opt->align_range_samples);
+    HASH_FIELD(h, opt->bips);
+    HASH_FIELD(h, opt->ch);
+    HASH_FIELD(h, opt->pcm_type);
+    HASH_FIELD(h, opt->is_bips_set);
+    HASH_FIELD(h, opt->is_ch_set);
+    HASH_FIELD(h, opt->drift_anchors);
+    HASH_FIELD(h, opt->resync_flag);
+    HASH_FIELD(h, opt->frac_flag);
+    HASH_FIELD(h, opt->align_ch_flag);
+    HASH_FIELD(h, opt->landmarks_flag);
+    HASH_FIELD(h, opt->align_mem_bytes);
+    HASH_FIELD(h, opt->lsb_thr_count);
+    h = hash_bytes(h, opt->lsb_thr, opt->lsb_thr_count * sizeof(opt->lsb_thr[0]));
+    key->options = h;
+    return 1;
+}
+
+
+int CACHE_lookup(const stat_cache_t * c, const cache_key_t * key, file_stat_t * stat)
+{
+    const size_t * slot = c->index_size ? find_slot(c, key) : NULL;
+    if (slot && *slot)
+    {
+        const cache_record_t * r = c->rec + *slot - 1;
+        wav_file_t * file[2];
+        wav_file_t * diff = stat->diff;
+        glitch_detector_t * glitch = stat->glitch;
+        resample_t * resampler = stat->resampler;
+        double * ch_shift_buf = stat->ch_shift_buf;
+        memcpy(file, stat->file, sizeof(file));
+
+        *stat = r->stat;
+        memcpy(stat->file, file, sizeof(file));
+        stat->diff = diff;
+        stat->glitch = glitch;
+        stat->resampler = resampler;
+        stat->ch_shift_buf = ch_shift_buf;
+        return 1;
+    }
+    return 0;
+}
+
+
+int CACHE_store(stat_cache_t * c, const cache_key_t * key, const file_stat_t * stat)
+{
+    cache_record_t r;
+    int replaced, ok;
+    memset(&r, 0, sizeof(r));
+    r.key = *key;
+    r.stat = *stat;
+    r.stat.file[0] = r.stat.file[1] = r.stat.diff = NULL;
+    r.stat.glitch = NULL;
+    r.stat.resampler = NULL;
+    r.stat.ch_shift_buf = NULL;
+    // Whole record is written under the lock: other process never sees a part of it
+    if (!lock_file(c->file, 1))
+    {
+        return 0;
+    }
+    fseek(c->file, 0, SEEK_END);
+    ok = fwrite(&r, sizeof(r), 1, c->file) == 1 && !fflush(c->file);
+    if (!lock_file(c->file, 0) || !ok)
+    {
+        return 0;
+    }
+    return add_record(c, &r, &replaced);
+}
@@ -0,0 +1,95 @@
+/** 18.10.2026 @file
+*   On-disk cache of file pair comparison results.
+*
+*   Result (file_stat_t, including alignment) is keyed by content hashes
+*   of both files and by options, which affect the result. Records are
+*   appended to the cache file, and looked up by hash table in memory.
+*   When loaded, the cache keeps only the latest record of each key, and
+*   is rewritten, if any were dropped. The cache file is discarded, if it
+*   was written with other FILE_STAT_VERSION or file_stat_t size.
+*   Loading/rewrite and each append hold an exclusive advisory lock of the
+*   cache file, so several wd processes may share one cache.
+*
+*   Example:
+*
+*   stat_cache_t * c = CACHE_open("wd.cache");
+*   if (CACHE_make_key(&key, wf, opt) && !CACHE_lookup(c, &key, &stat))
+*   {
+*       compare(&stat);
+*       CACHE_store(c, &key, &stat);
+*   }
+*   CACHE_close(c);
+*/
+
+#ifndef statcache_H_INCLUDED
+#define statcache_H_INCLUDED
+
+#include "wd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  //__cplusplus
+
+/**
+*   Cache key: file pair and options
+*/
+typedef struct
+{
+    uint64_t                hash[2];            //!< Content hash of each file
+    uint64_t                size[2];            //!< Size of each file, bytes
+    uint64_t                options;            //!< Hash of options, which affect the result
+} cache_key_t;
+
+typedef struct stat_cache_t stat_cache_t;
+
+/**
+*   Load cache file, creating it if not exists
+*   @return cache handle, or NULL if file can't be opened or no memory
+*/
+stat_cache_t * CACHE_open(
+    const TCHAR *           path                //!< Cache file name
+    );
+
+/**
+*   Close cache file and release the handle
+*/
+void CACHE_close(
+    stat_cache_t *          c                   //!< Cache handle
+    );
+
+/**
+*   Build key for opened file pair. Whole files are read; file positions
+*   are restored.
+*   @return 0 if read error
+*/
+int CACHE_make_key(
+    cache_key_t *           key,                //!< [OUT] Cache key
+    wav_file_t *            wf[2],              //!< Pair of files
+    const cmdline_options_t * opt               //!< Comparison options
+    );
+
+/**
+*   Find cached result. File handles and other pointers of stat are kept.
+*   @return 1 if found
+*/
+int CACHE_lookup(
+    const stat_cache_t *    c,                  //!< Cache handle
+    const cache_key_t *     key,                //!< Cache key
+    file_stat_t *           stat                //!< [OUT] Comparison result
+    );
+
+/**
+*   Add comparison result to the cache
+*   @return 0 if write error or no memory
+*/
+int CACHE_store(
+    stat_cache_t *          c,                  //!< Cache handle
+    const cache_key_t *     key,                //!< Cache key
+    const file_stat_t *     stat                //!< Comparison result
+    );
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif //statcache_H_INCLUDED
@@ -2,6 +2,8 @@
 #include "sys_dirlist.h"
 #include "output.h"
 #include "f_wav_align.h"
+#include "sys_thread.h"
+#include "statcache.h"
 #include "wd.h"
 #include <assert.h>
 #include <stdio.h>
@@ -23,6 +25,46 @@ extern int lzf_decompress_data_to_file(FILE * f); // help.c
 // Audio buffer size
 #define BUF_SIZE_SAMPLES (0x20000)
 
+// Default number of anchor points for clock drift estimation
+#define DEFAULT_DRIFT_ANCHORS 8
+
+// Drift below this value (relative) is ignored
+#define MIN_DRIFT 1e-8
+
+// Drift above this value (relative) is treated as estimation failure
+#define MAX_DRIFT 1e-2
+
+// Fractional delay below this value (samples) is ignored
+#define MIN_FRAC_DELAY 0.01
+
+// Re-alignment: error energy is monitored in windows of this size, samples
+#define RESYNC_WINDOW 1024
+
+// Re-alignment: window is lost if difference energy exceeds this fraction of signals energy...
+#define RESYNC_LOST_RATIO 0.01
+
+// Re-alignment: ...and also exceeds average ratio in matching windows by this factor
+#define RESYNC_JUMP 100
+
+// Re-alignment: number of consecutive lost windows, which triggers re-alignment
+#define RESYNC_LOST_WINDOWS 4
+
+// Re-alignment: windows with lower energy per sample are not monitored
+#define RESYNC_SILENCE 1e-8
+
+// Single file statistic: block size, samples (all channels)
+#define STAT_BLOCK_SAMPLES (BUF_SIZE_SAMPLES * 8)
+
+// Single file statistic: max number of worker threads
+#define STAT_THREADS_MAX 16
+
+// Single file statistic: min number of samples per worker thread
+#define STAT_THREAD_MIN_SAMPLES 0x4000
+
+// Single file statistic: max number of distinct values in high-resolution histograms.
+// Each worker uses the same limit, so resolution does not depend on the number of threads.
+#define STAT_HIST_ENTRIES (1 << 20)
+
 // Default sample rate, used when generating difference for RAW PCM files.
 #define DEFAULT_SAMPLERATE 44100
 
@@ -40,12 +82,18 @@ extern int lzf_decompress_data_to_file(FILE * f); // help.c
 
 static TCHAR g_lazy_output_dir[MAX_PATH];
 static double g_buf[3][BUF_SIZE_SAMPLES];
+static double g_resample_buf[BUF_SIZE_SAMPLES];
+static size_t g_resample_fill;
 
 static __int64      g_current_file_size;
 static __int64      g_total_file_size;
 static summary_stat_t g_tot;
 static cmdline_options_t g_opt;
 static int          g_abort_flag = 0;
+static align_ctx_t * g_align;
+static stat_cache_t * g_cache;
+static cache_key_t  g_cache_key;
+static int          g_cache_key_valid;
 
 
 
@@ -95,6 +143,58 @@ static int atoi_ex(TCHAR* p)
 }
 
 
+/**
+*   Insert difference counter threshold into sorted list
+*   @return 0 if too many thresholds
+*/
+static int add_lsb_threshold(cmdline_options_t *opt, double thr)
+{
+    unsigned int i, k;
+    for (i = 0; i < opt->lsb_thr_count && opt->lsb_thr[i] < thr; i++)
+    {
+    }
+    if (i < opt->lsb_thr_count && opt->lsb_thr[i] == thr)
+    {
+        return 1;
+    }
+    if (opt->lsb_thr_count == MAX_LSB_THRESHOLDS)
+    {
+        _tprintf(_T("ERROR: too many LSB thresholds (max %d)\n"), MAX_LSB_THRESHOLDS);
+        return 0;
+    }
+    for (k = opt->lsb_thr_count++; k > i; k--)
+    {
+        opt->lsb_thr[k] = opt->lsb_thr[k - 1];
+    }
+    opt->lsb_thr[i] = thr;
+    return 1;
+}
+
+
+/**
+*   Parse comma-separated list of LSB thresholds
+*/
+static int parse_lsb_list(TCHAR * p, cmdline_options_t *opt)
+{
+    do
+    {
+        TCHAR * end;
+        double thr = _tcstod(p, &end);
+        if (end == p || thr < 0 || (*end && *end != ','))
+        {
+            _tprintf(_T("ERROR: bad LSB threshold list %s\n"), p);
+            return 0;
+        }
+        if (!add_lsb_threshold(opt, thr))
+        {
+            return 0;
+        }
+        p = end;
+    } while (*p++);
+    return 1;
+}
+
+
 static void usage(void)
 {
     puts("\n"
@@ -119,6 +219,17 @@ static void usage(void)
     "-os2:<int>   0         Ignore <int> initial samples of the second file\n"
     "-align<int>  No        Use \"Best Match\" offset sample before comparison.\n"
     "-saveAligned No        Write aligned second file instead of difference\n"
+    "-glitch      No        Report dropouts, zero runs and repeated blocks\n"
+    "-drift<int>  No        Estimate clock drift at <int> points, resample 2nd file\n"
+    "-frac        No        Compensate sub-sample delay by resampling 2nd file\n"
+    "-alignch     No        Align each channel separately\n"
+    "-fp          No        Find large -align offsets by spectral fingerprints\n"
+    "-mem<int>    40M       Limit -align buffers to <int> bytes\n"
+    "-resync      No        Re-align files after dropouts during comparison\n"
+    "-edits       No        Report inserted, deleted and repeated segments\n"
+    "-lsb<list>   No        Count samples differing by more than <list> LSB\n"
+    "-tol<n[,m]>  No        Fail if diff exceeds <n> LSB or <m> samples differ\n"
+    "-cache<file> No        Reuse results of unchanged file pairs from <file>\n"
     "-wo          No        No warn on file open fail\n"
     "-h           No        Produce wd.html help file\n"
     "=============================================================================\n"
@@ -131,7 +242,19 @@ static void usage(void)
     "   so it gives you a chance to compare parts after dropouts\n"
     " * If only one file name given, file statistics reported\n"
     " * -align option can take <int> argument to increase alignment buffer size\n"
+    " * Large -align ranges are searched coarse-to-fine with bounded memory\n"
+    " * -fp helps when the offset is large compared to the file length\n"
+    " * -mem sets the size of direct (not coarse-to-fine) -align search;\n"
+    "   it is shared by all channels\n"
+    " * -drift implies -align; alignment range must cover drift over the file\n"
+    " * -resync implies -align; it is not used with drift compensation\n"
+    " * -frac implies -align; it is not used with -resync\n"
+    " * -alignch implies -align; it is not used with -drift, -frac and -resync\n"
     " * -short listing difference always shown in 16-bit samples\n"
+    " * LSB is a quantization step of the file with fewer bits per sample\n"
+    " * With -tol, exit code reports tolerance check instead of bit-exactness\n"
+    " * -cache keys results by file content and options; it is not used with\n"
+    "   -glitch, -edits and difference file output\n"
     "Examples:\n"
     "wd -align256k -ls reference.wav totest.wav diff.wav -rTestReport.txt\n"
     "wd ref/*.wav test/*.raw -align\n"
@@ -158,7 +281,11 @@ static int read_cmdline_options (int argc, TCHAR *argv[], cmdline_options_t *opt
            )
         {
             p++;
-            if (smatch(_T("r"), &p))
+            if (smatch(_T("resync"), &p))
+            {
+                opt->resync_flag = 1;
+            }
+            else if (smatch(_T("r"), &p))
             {
                 if (!*p)
                 {
@@ -198,6 +325,15 @@ static int read_cmdline_options (int argc, TCHAR *argv[], cmdline_options_t *opt
                 opt->is_bips_set = 1;
                 opt->bips = _ttoi(p);
             }
+            else if (smatch(_T("cache"), &p))
+            {
+                if (!*p)
+                {
+                    _tprintf(_T("ERROR: -cache option without file name\n"));
+                    return 0;
+                }
+                opt->cache_name = p;
+            }
             else if (smatch(_T("ch"), &p))
             {
                 opt->ch = _ttoi(p);
@@ -207,6 +343,13 @@ static int read_cmdline_options (int argc, TCHAR *argv[], cmdline_options_t *opt
             {
                 opt->no_warn_cant_open = 1;
             }
+            else if (smatch(_T("lsb"), &p))
+            {
+                if (!parse_lsb_list(p, opt))
+                {
+                    return 0;
+                }
+            }
             else if (smatch(_T("ls"), &p))
             {
                 opt->listing = E_LISTING_SHORT;
@@ -239,6 +382,55 @@ static int read_cmdline_options (int argc, TCHAR *argv[], cmdline_options_t *opt
             {
                 opt->save_aligned_flag = 1;
             }
+            else if (smatch(_T("glitch"), &p))
+            {
+                opt->glitch_flag = 1;
+            }
+            else if (smatch(_T("edits"), &p))
+            {
+                opt->edit_list_flag = 1;
+            }
+            else if (smatch(_T("drift"), &p))
+            {
+                opt->drift_anchors = *p ? _ttoi(p) : DEFAULT_DRIFT_ANCHORS;
+            }
+            else if (smatch(_T("mem"), &p))
+            {
+                opt->align_mem_bytes = atoi_ex(p);
+            }
+            else if (smatch(_T("fp"), &p))
+            {
+                opt->landmarks_flag = 1;
+            }
+            else if (smatch(_T("frac"), &p))
+            {
+                opt->frac_flag = 1;
+            }
+            else if (smatch(_T("tol"), &p))
+            {
+                TCHAR * end;
+                opt->tol_flag = 1;
+                opt->tol_lsb = _tcstod(p, &end);
+                opt->tol_count = 0;
+                if (*end == ',')
+                {
+                    opt->tol_count = _ttoi(end + 1);
+                }
+                if (end == p || opt->tol_lsb < 0 || opt->tol_count < 0 || (*end && *end != ','))
+                {
+                    _tprintf(_T("ERROR: bad tolerance %s\n"), p);
+                    return 0;
+                }
+                // Tolerance check uses difference counters
+                if (!add_lsb_threshold(opt, opt->tol_lsb) || (opt->tol_count && !add_lsb_threshold(opt, 0)))
+                {
+                    return 0;
+                }
+            }
+            else if (smatch(_T("alignch"), &p))
+            {
+                opt->align_ch_flag = 1;
+            }
             else if (smatch(_T("align"), &p))
             {
                 opt->align_range_samples = *p ? atoi_ex(p) : 1024*8*2;
@@ -326,6 +518,17 @@ static int verify_cmdline_options(cmdline_options_t *opt)
         return 0;
     }
 
+    if (opt->drift_anchors < 0 || opt->drift_anchors == 1)
+    {
+        _tprintf(_T("ERROR: At least 2 drift estimation points required\n"));
+        return 0;
+    }
+
+    if ((opt->drift_anchors || opt->resync_flag || opt->frac_flag || opt->align_ch_flag) && opt->align_range_samples <= 0)
+    {
+        opt->align_range_samples = 1024*8*2;
+    }
+
     return 1;
 }
 
@@ -445,6 +648,151 @@ static int open_file(file_stat_t * stat, const cmdline_options_t * opt, int idx)
 }
 
 
+/**
+*   Align files and set up resampling of the 2nd file: sample pos of the
+*   2nd file matches sample pos*(1 + drift) + offset of the 1st one.
+*   @return 0 if no memory
+*/
+static int start_resampling(file_stat_t * stat, double offset, double drift)
+{
+    wav_file_t ** file = stat->file;
+    double ratio, phase;
+    long skip[2] = {0, 0};
+    int i;
+
+    // Sample n of the 1st file (after skip) is interpolated from the 2nd file at position n*ratio + phase
+    ratio = 1 / (1 + drift);
+    if (offset >= 0)
+    {
+        skip[0] = (long)ceil(offset);
+        phase = (skip[0] - offset) * ratio;
+    }
+    else
+    {
+        skip[1] = (long)floor(-offset * ratio);
+        phase = -offset * ratio - skip[1];
+    }
+
+    stat->resampler = RESAMPLE_alloc(file[1]->fmt.ch, ratio, phase, 0);
+    if (!stat->resampler)
+    {
+        my_printf(_T("WARNING: not enough memory for resampler\n"));
+        return 0;
+    }
+    for (i = 0; i < 2; i++)
+    {
+        fseek(file[i]->file, skip[i] * WAV_bytes_per_sample(file[i]), SEEK_CUR);
+    }
+    g_resample_fill = 0;
+    return 1;
+}
+
+
+/**
+*   Estimate clock drift, align files and set up resampling of the 2nd file
+*   @return 0 if no drift found
+*/
+static int align_drift(file_stat_t * stat, const cmdline_options_t * opt)
+{
+    double offset, drift;
+
+    if (!ALIGN_estimate_drift(g_align, stat->file[0], stat->file[1], opt->drift_anchors, &offset, &drift) ||
+        fabs(drift) < MIN_DRIFT || fabs(drift) > MAX_DRIFT ||
+        !start_resampling(stat, offset, drift))
+    {
+        return 0;
+    }
+    stat->drift_ppm = drift * 1e6;
+    return 1;
+}
+
+
+/**
+*   Find sub-sample delay, align files and set up fractional delay
+*   resampling of the 2nd file
+*   @return 0 if delay is whole number of samples
+*/
+static int align_frac(file_stat_t * stat)
+{
+    double delay;
+
+    if (!ALIGN_find_delay(g_align, stat->file[0], stat->file[1], &delay) ||
+        fabs(delay - floor(delay + 0.5)) < MIN_FRAC_DELAY ||
+        !start_resampling(stat, delay, 0))
+    {
+        return 0;
+    }
+    stat->delay = delay;
+    return 1;
+}
+
+
+/**
+*   Find offset of each channel, align files by the smallest one and set
+*   up read-ahead of 1st file channels by the rest
+*   @return 0 if offsets not found
+*/
+static int align_channels(file_stat_t * stat)
+{
+    wav_file_t ** file = stat->file;
+    unsigned int c, nch = file[0]->fmt.ch;
+    long lo, hi;
+
+    if (!ALIGN_find_channel_offsets(g_align, file[0], file[1], stat->ch_offset))
+    {
+        return 0;
+    }
+    lo = hi = stat->ch_offset[0];
+    for (c = 1; c < nch; c++)
+    {
+        lo = MIN(lo, stat->ch_offset[c]);
+        hi = MAX(hi, stat->ch_offset[c]);
+    }
+    if (hi > lo)
+    {
+        stat->ch_shift_buf = malloc((BUF_SIZE_SAMPLES / nch + (hi - lo)) * nch * sizeof(double));
+        if (!stat->ch_shift_buf)
+        {
+            my_printf(_T("WARNING: not enough memory for channel alignment\n"));
+            return 0;
+        }
+        for (c = 0; c < nch; c++)
+        {
+            stat->ch_shift[c] = stat->ch_offset[c] - lo;
+        }
+        stat->ch_shift_max = hi - lo;
+        stat->ch_shift_fill = 0;
+    }
+    if (lo > 0)
+    {
+        fseek(file[0]->file, lo * WAV_bytes_per_sample(file[0]), SEEK_CUR);
+    }
+    else if (lo < 0)
+    {
+        fseek(file[1]->file, -lo * WAV_bytes_per_sample(file[1]), SEEK_CUR);
+    }
+    return 1;
+}
+
+
+/**
+*   Find comparison result of the file pair in the cache. Cache key is kept
+*   to store the result after comparison.
+*   @return 1 if result found
+*/
+static int cache_lookup(file_stat_t * stat, const cmdline_options_t * opt)
+{
+    g_cache_key_valid = 0;
+    if (!g_cache || opt->glitch_flag || opt->edit_list_flag || opt->file_name[2])
+    {
+        return 0;
+    }
+    g_cache_key_valid = CACHE_make_key(&g_cache_key, stat->file, opt);
+    stat->from_cache = g_cache_key_valid && CACHE_lookup(g_cache, &g_cache_key, stat);
+    return stat->from_cache;
+}
+
+
 static int open_files(file_stat_t * stat, cmdline_options_t *opt)
 {
     int i;
@@ -512,15 +860,29 @@ static int open_files(file_stat_t * stat, cmdline_options_t *opt)
         stat->diff = WAV_open_write(opt->file_name[2], fmt, EFILE_WAV);
     }
 
+    // Same pair compared with the same options: take result from the cache
+    if (cache_lookup(stat, opt))
+    {
+        return 1;
+    }
+
     // Align files if specified
     if (opt->align_range_samples > 0)
     {
-        if (!ALIGN_init(g_opt.align_range_samples, file[0]->fmt.ch))
+        ALIGN_free(g_align);
+        g_align = ALIGN_create(opt->align_range_samples, file[0]->fmt.ch,
+                               opt->landmarks_flag ? E_ALIGN_COARSE_LANDMARKS : E_ALIGN_COARSE_ENVELOPE,
+                               opt->align_mem_bytes);
+        if (!g_align)
         {
             my_printf(_T("ERROR: memory allocation error.\n"));
             goto Cleanup;
         }
-        ALIGN_align_pair(file[0], file[1]);
+        if (opt->align_ch_flag ? !align_channels(stat) :
+            (!opt->drift_anchors || !align_drift(stat, opt)) && (!opt->frac_flag || !align_frac(stat)))
+        {
+            stat->align_psr = ALIGN_align_pair(g_align, file[0], file[1]);
+        }
     }
 
     return 1;
@@ -541,6 +903,8 @@ Cleanup:
 static void diff_stat_gather(file_stat_t * stat, const double * p1, const double * p2, double * diff, size_t nsamples)
 {
     unsigned int i, c;
+    unsigned int nthr = stat->lsb_thr_count;
+    const double * thr = stat->lsb_thr;
     for (i = 0; i < nsamples; i++)
     {
         for (c = 0; c < stat->nch; c++)
@@ -561,6 +925,16 @@ static void diff_stat_gather(file_stat_t * stat, const double * p1, const double
             s->d_mul_dm1 += d * s->dm1;
             s->dm1 = d;
 #endif
+            if (nthr && fabs(d) > thr[0])
+            {
+                // Thresholds are sorted: most samples pass 1st check
+                double a = fabs(d);
+                unsigned int k;
+                for (k = 0; k < nthr && a > thr[k]; k++)
+                {
+                    s->lsb_over[k]++;
+                }
+            }
         }
     }
     stat->samlpes_count += nsamples;
@@ -570,10 +944,14 @@ static void diff_stat_gather(file_stat_t * stat, const double * p1, const double
 static void diff_stat_sum_channels(file_stat_t * stat)
 {
     channel_stat_t * avr = stat->ch + stat->nch;
-    unsigned int c;
+    unsigned int c, k;
     for (c = 0; c < stat->nch; c++)
     {
         channel_stat_t * s = stat->ch + c;
+        for (k = 0; k < stat->lsb_thr_count; k++)
+        {
+            avr->lsb_over[k] += s->lsb_over[k];
+        }
         avr->d_max = MAX(avr->d_max, s->d_max);
         avr->d_min = MIN(avr->d_min, s->d_min);
         avr->d_mul_r += s->d_mul_r;
@@ -594,6 +972,50 @@ double diff_stat_abs_max(channel_stat_t * stat)
 }
 
 
+/**
+*   @return bits per sample, used to express difference in LSB: minimum
+*   of compared files; 16 if both files are floating-point
+*/
+int diff_stat_bips(wav_file_t * wf[2])
+{
+    int bips = MIN(labs(wf[0]->fmt.bips), labs(wf[1]->fmt.bips));
+    if (wf[0]->fmt.pcm_type == E_PCM_IEEE_FLOAT)
+    {
+        bips = wf[1]->fmt.pcm_type == E_PCM_IEEE_FLOAT ? 16 : labs(wf[1]->fmt.bips);
+    }
+    if (wf[1]->fmt.pcm_type == E_PCM_IEEE_FLOAT)
+    {
+        bips = wf[0]->fmt.pcm_type == E_PCM_IEEE_FLOAT ? 16 : labs(wf[0]->fmt.bips);
+    }
+    return bips;
+}
+
+
+/**
+*   Check tolerance: no sample differs by more than opt->tol_lsb LSB, and
+*   fewer than opt->tol_count samples differ at all
+*   @return 1 if check failed
+*/
+static int diff_stat_tol_failed(file_stat_t * stat, const cmdline_options_t * opt)
+{
+    const channel_stat_t * tot = stat->ch + stat->nch;
+    unsigned int k;
+    int failed = 0;
+    for (k = 0; k < stat->lsb_thr_count; k++)
+    {
+        if (opt->lsb_thr[k] == opt->tol_lsb && tot->lsb_over[k])
+        {
+            failed = 1;
+        }
+        if (opt->lsb_thr[k] == 0 && opt->tol_count && tot->lsb_over[k] >= (uint64_t)opt->tol_count)
+        {
+            failed = 1;
+        }
+    }
+    return failed;
+}
+
+
 static void diff_stat_update_totals(file_stat_t * stat, summary_stat_t * tot, const TCHAR * file_name) 
 {
     channel_stat_t * sumch = stat->ch + stat->nch;
@@ -620,69 +1042,508 @@ static void diff_stat_update_totals(file_stat_t * stat, summary_stat_t * tot, co
     }
 }
 
+/**
+*   Read samples from one of compared files. 2nd file is resampled, if
+*   clock drift compensation is active; channels of the 1st file are read
+*   ahead by own shifts, if channels are aligned separately.
+*/
+static size_t read_samples(file_stat_t * stat, int idx, double * buf, size_t count)
+{
+    wav_file_t * file = stat->file[idx];
+    unsigned int nch = file->fmt.ch;
+    size_t produced = 0;
+
+    if (!idx && stat->ch_shift_buf)
+    {
+        size_t i;
+        unsigned int c;
+        double * fifo = stat->ch_shift_buf;
+        stat->ch_shift_fill += WAV_read_doubles(file, fifo + stat->ch_shift_fill * nch, 
+                                                count + stat->ch_shift_max - stat->ch_shift_fill);
+        if (stat->ch_shift_fill > stat->ch_shift_max)
+        {
+            produced = MIN(count, stat->ch_shift_fill - stat->ch_shift_max);
+        }
+        for (i = 0; i < produced; i++)
+        {
+            for (c = 0; c < nch; c++)
+            {
+                buf[i * nch + c] = fifo[(i + stat->ch_shift[c]) * nch + c];
+            }
+        }
+        stat->ch_shift_fill -= produced;
+        memmove(fifo, fifo + produced * nch, stat->ch_shift_fill * nch * sizeof(double));
+        return produced;
+    }
+    if (!idx || !stat->resampler)
+    {
+        return WAV_read_doubles(file, buf, count);
+    }
+
+    while (produced < count)
+    {
+        size_t used, n;
+        size_t got = WAV_read_doubles(file, g_resample_buf + g_resample_fill * nch, BUF_SIZE_SAMPLES / nch - g_resample_fill);
+        g_resample_fill += got;
+        n = RESAMPLE_process(stat->resampler, g_resample_buf, g_resample_fill, &used, buf + produced * nch, count - produced);
+        g_resample_fill -= used;
+        memmove(g_resample_buf, g_resample_buf + used * nch, g_resample_fill * nch * sizeof(double));
+        produced += n;
+        if (!n && !got)
+        {
+            break;
+        }
+    }
+    return produced;
+}
+
+
+/**
+*   Error energy monitor state for re-alignment
+*/
+typedef struct
+{
+    double          e_ref;                      //!< Reference energy in current window
+    double          e_test;                     //!< Test energy in current window
+    double          e_diff;                     //!< Difference energy in current window
+    size_t          fill;                       //!< Samples in current window
+    size_t          lost;                       //!< Number of consecutive lost windows
+    size_t          lost_start;                 //!< Position of the 1st lost window in the current block
+    double          baseline;                   //!< Average difference to signal energy ratio in matching windows
+    int             armed;                      //!< Matching window seen since start or last re-alignment
+    int             realign;                    //!< Lost run found by the last scan: files to be re-aligned
+} resync_monitor_t;
+
+
+/**
+*   Scan block for sustained error energy jump. Lost run, not confirmed by
+*   the end of block, and incomplete window are not compared: they are
+*   scanned again with the next block, so windows never span blocks.
+*   @return number of samples to compare: start of lost run, if m->realign is set
+*/
+static size_t resync_scan(resync_monitor_t * m, const double * ref, const double * test, size_t nsamples, unsigned int nch)
+{
+    size_t i, keep;
+    unsigned int c;
+
+    m->realign = 0;
+    for (i = 0; i < nsamples; i++)
+    {
+        for (c = 0; c < nch; c++)
+        {
+            double r = *ref++;
+            double t = *test++;
+            m->e_ref += SQR(r);
+            m->e_test += SQR(t);
+            m->e_diff += SQR(t - r);
+        }
+        if (++m->fill == RESYNC_WINDOW)
+        {
+            double e_sig = m->e_ref + m->e_test;
+            if (e_sig >= RESYNC_SILENCE * RESYNC_WINDOW * nch)
+            {
+                double ratio = m->e_diff / e_sig;
+                if (ratio > RESYNC_LOST_RATIO && ratio > RESYNC_JUMP * m->baseline)
+                {
+                    if (!m->lost++)
+                    {
+                        m->lost_start = i + 1 - RESYNC_WINDOW;
+                    }
+                }
+                else
+                {
+                    m->baseline = m->armed ? m->baseline + (ratio - m->baseline) / 16 : ratio;
+                    m->lost = 0;
+                    m->armed = 1;
+                }
+            }
+            m->e_ref = m->e_test = m->e_diff = 0;
+            m->fill = 0;
+            if (m->armed && m->lost >= RESYNC_LOST_WINDOWS)
+            {
+                m->lost = 0;
+                m->armed = 0;
+                m->realign = 1;
+                return m->lost_start;
+            }
+        }
+    }
+    keep = m->armed && m->lost ? nsamples - m->lost_start : m->fill;
+    m->e_ref = m->e_test = m->e_diff = 0;
+    m->fill = 0;
+    m->lost = 0;
+    // Whole block is kept at the end of files only: it is compared
+    return keep < nsamples ? nsamples - keep : nsamples;
+}
+
+
+/**
+*   Move files back to the given compared position
+*/
+static void rewind_files(file_stat_t * stat, const size_t samples[2], size_t compared)
+{
+    int i;
+    for (i = 0; i < 2; i++)
+    {
+        fseek(stat->file[i]->file, -(long)((samples[i] - compared) * WAV_bytes_per_sample(stat->file[i])), SEEK_CUR);
+    }
+}
+
+
+/**
+*   Re-align files from the start of the lost run. The skip is placed at the
+*   sample of the 1st lost window, which minimizes squared error of samples
+*   before it at old alignment and after it at new alignment. If no offset
+*   is found, files are not moved and no event is recorded.
+*   @return number of block samples to compare at old alignment
+*/
+static size_t resync_files(file_stat_t * stat, size_t compared, size_t count, unsigned long skipped[2])
+{
+    int i, s;
+    wav_file_t ** file = stat->file;
+    unsigned int nch = stat->nch;
+    unsigned int bps, c;
+    wavpos_t pos[2];
+    long offset;
+    size_t split = 0;
+    size_t k, n;
+    const double * u;
+    const double * v;
+    const double * w = g_buf[2];
+    double cost = 0, best;
+    resync_event_t e;
+
+    // Match right at the mismatch: content-selected window may pass the next edit.
+    // Nothing found or nothing to skip: no re-alignment
+    skipped[0] = skipped[1] = 0;
+    if (!ALIGN_find_offset(g_align, file[0], file[1], &offset) || !offset)
+    {
+        return compared;
+    }
+    for (i = 0; i < 2; i++)
+    {
+        pos[i] = WAV_get_sample_pos(file[i]);
+    }
+
+    // Skipped file at new alignment (g_buf[2]) and old one (block), compared with the other file
+    s = offset > 0 ? 0 : 1;
+    bps = WAV_bytes_per_sample(file[s]);
+    u = g_buf[!s] + compared * nch;
+    v = g_buf[s] + compared * nch;
+    fseek(file[s]->file, labs(offset) * bps, SEEK_CUR);
+    n = WAV_read_doubles(file[s], g_buf[2], MIN(RESYNC_WINDOW, count - compared));
+    for (k = 0; k < n * nch; k++)
+    {
+        cost += SQR(u[k] - w[k]);
+    }
+    best = cost;
+    for (k = 0; k < n; k++)
+    {
+        for (c = 0; c < nch; c++)
+        {
+            cost += SQR(u[k * nch + c] - v[k * nch + c]) - SQR(u[k * nch + c] - w[k * nch + c]);
+        }
+        if (cost < best)
+        {
+            best = cost;
+            split = k + 1;
+        }
+    }
+    fseek(file[s]->file, -(long)((n - split) * bps), SEEK_CUR);
+    fseek(file[!s]->file, (long)(split * WAV_bytes_per_sample(file[!s])), SEEK_CUR);
+
+    e.pos = pos[0] + split;
+    for (i = 0; i < 2; i++)
+    {
+        e.skipped[i] = skipped[i] = (unsigned long)(WAV_get_sample_pos(file[i]) - pos[i] - split);
+        stat->resync_skipped[i] += e.skipped[i];
+    }
+    if (stat->resync_count < MAX_RESYNC_EVENTS)
+    {
+        stat->resync[stat->resync_count] = e;
+    }
+    stat->resync_count++;
+    return compared + split;
+}
+
+
 static int CompareFiles (file_stat_t * stat, cmdline_options_t * opt)
 {
     int succeess = 0;
     wav_file_t ** file = stat->file; 
     int phase = 0;
+    int resync = opt->resync_flag && !stat->resampler && !stat->ch_shift_buf;
+    resync_monitor_t monitor;
     stat->nch = file[0]->fmt.ch;
+    memset(&monitor, 0, sizeof(monitor));
 
     while (!esc_pressed())
     {
-        size_t samples[2], samplesToCompare;
+        size_t samples[2], samplesToCompare, samplesRead;
+        unsigned long skipped[2] = {0, 0};
 
-        samples[phase] = WAV_read_doubles(file[phase], g_buf[phase], BUF_SIZE_SAMPLES / file[phase]->fmt.ch );
+        samples[phase] = read_samples(stat, phase, g_buf[phase], BUF_SIZE_SAMPLES / file[phase]->fmt.ch );
         phase ^= 1;
-        samples[phase] = WAV_read_doubles(file[phase], g_buf[phase], BUF_SIZE_SAMPLES / file[phase]->fmt.ch );
+        samples[phase] = read_samples(stat, phase, g_buf[phase], BUF_SIZE_SAMPLES / file[phase]->fmt.ch );
         
-        samplesToCompare = MIN(samples[0], samples[1]);
+        samplesToCompare = samplesRead = MIN(samples[0], samples[1]);
         if (!samplesToCompare)
         {
             succeess = 1;
             break;
         }
+        if (resync)
+        {
+            samplesToCompare = resync_scan(&monitor, g_buf[0], g_buf[1], samplesRead, stat->nch);
+            if (samplesToCompare != samplesRead)
+            {
+                rewind_files(stat, samples, samplesToCompare);
+            }
+            if (monitor.realign)
+            {
+                samplesToCompare = resync_files(stat, samplesToCompare, samplesRead, skipped);
+            }
+        }
 
         diff_stat_gather(stat, g_buf[0], g_buf[1], g_buf[2], samplesToCompare);
+        if (stat->glitch)
+        {
+            GLITCH_process(stat->glitch, g_buf[0], g_buf[1], samplesToCompare);
+        }
         if (stat->diff)
         {
             WAV_write_doubles(stat->diff, g_buf[opt->save_aligned_flag?1:2], samplesToCompare);
         }
+        // Keep aligned output in sync with the 1st file
+        if (opt->save_aligned_flag && stat->diff && skipped[0])
+        {
+            double buf[MAX_CH] = {0,};
+            unsigned long n;
+            for (n = 0; n < skipped[0]; n++)
+            {
+                WAV_write_doubles(stat->diff, buf, 1);
+            }
+        }
 
         GAUGE_set_pos((double) (stat->samlpes_count * WAV_bytes_per_sample(file[0]) + g_current_file_size) /
                      g_total_file_size);
 
     }
     diff_stat_sum_channels(stat);
+    if (stat->glitch)
+    {
+        GLITCH_flush(stat->glitch);
+    }
     return succeess;
 }
 
 
-static void InfoUpdate(TFileInfo* info, double * buf, size_t n)
+/**
+*   Single file statistic: worker thread job
+*/
+typedef struct
+{
+    TFileInfo       info;                       //!< Private partial statistic
+    const double *  buf;                        //!< Samples to process
+    size_t          count;                      //!< Number of samples per channel
+} stat_worker_t;
+
+
+static void InfoUpdate(TFileInfo* info, const double * buf, size_t n)
 {
     size_t i;
+    unsigned int nch = info->stat.nch;
     for (i = 0; i < n; i++)
     {
         unsigned int c;
-        for (c = 0; c < info->stat.nch; c++)
+        for (c = 0; c < nch; c++)
         {
+            channel_stat_t * s = info->stat.ch + c;
             double val = *buf++;
-            //double val2 = val * val;
-            val = MAX(val, -1); val = MIN(val, (double)0x7FFF/0x8000);
+            s->d_max = MAX(val, s->d_max);
+            s->d_min = MIN(val, s->d_min);
+            s->d_sum += val;
+            s->d_sumSqr += SQR(val);
+#if ACF
+            s->d_mul_dm1 += val * s->dm1;
+            s->dm1 = val;
+#endif
+            if (info->hist_float)
+            {
+                float f = (float)val;
+                unsigned int code;
+                memcpy(&code, &f, sizeof(code));
+                HIST_add(info->hist_float, code);
+            }
+            val = MAX(val, -1);
+            if (info->hist_q23)
+            {
+                HIST_add(info->hist_q23, (long) (0x800000 * MIN(val, (double)0x7FFFFF/0x800000)) + 0x800000);
+            }
+            val = MIN(val, (double)0x7FFF/0x8000);
             info->usedBits32 |= (long) (0x80000000 * val);
             info->histogram64k[(long) (0x8000 * val) + 0x8000]++;
             info->histogram256[(long) (0x80 * val) + 0x80]++;
         }   
     }
+    info->stat.samlpes_count += n;
+}
+
+
+static void InfoWorker(void * arg)
+{
+    stat_worker_t * w = (stat_worker_t *)arg;
+    InfoUpdate(&w->info, w->buf, w->count);
+}
+
+
+/**
+*   Add partial statistic to the total
+*/
+static void InfoMerge(TFileInfo* info, const TFileInfo* part)
+{
+    unsigned int c;
+    long i;
+    for (c = 0; c < info->stat.nch; c++)
+    {
+        channel_stat_t * s = info->stat.ch + c;
+        const channel_stat_t * p = part->stat.ch + c;
+        s->d_max = MAX(s->d_max, p->d_max);
+        s->d_min = MIN(s->d_min, p->d_min);
+        s->d_sum += p->d_sum;
+        s->d_sumSqr += p->d_sumSqr;
+#if ACF
+        s->d_mul_dm1 += p->d_mul_dm1;
+#endif
+        s->r_sumSqr = 0;
+        s->d_mul_r = 0;
+        s->t_sumSqr = s->d_sumSqr;
+    }
+    info->stat.samlpes_count += part->stat.samlpes_count;
+    info->usedBits32 |= part->usedBits32;
+    if (info->hist_q23 && part->hist_q23)
+    {
+        HIST_merge(info->hist_q23, part->hist_q23);
+    }
+    if (info->hist_float && part->hist_float)
+    {
+        HIST_merge(info->hist_float, part->hist_float);
+    }
+    for (i = 0; i < 0x10000; i++)
+    {
+        info->histogram64k[i] += part->histogram64k[i];
+    }
+    for (i = 0; i < 256; i++)
+    {
+        info->histogram256[i] += part->histogram256[i];
+    }
+}
+
+
+/**
+*   Process block of samples by worker threads. Each worker gathers private
+*   partial statistic for a slice of the block.
+*/
+static void InfoUpdateParallel(stat_worker_t * w, unsigned int threads, const double * buf, size_t n)
+{
+    thread_t * t[STAT_THREADS_MAX];
+    unsigned int nch = w[0].info.stat.nch;
+    unsigned int i, c;
+    size_t start = 0;
+
+    threads = (unsigned int)MIN(threads, 1 + n * nch / STAT_THREAD_MIN_SAMPLES);
+    for (i = 0; i < threads; i++)
+    {
+        size_t end = n * (i + 1) / threads;
+        w[i].buf = buf + start * nch;
+        w[i].count = end - start;
+#if ACF
+        // Lag product across slice boundary; first slice continues previous block
+        for (c = 0; c < nch && start; c++)
+        {
+            w[i].info.stat.ch[c].dm1 = buf[(start - 1) * nch + c];
+        }
+#endif
+        start = end;
+    }
+    for (i = 1; i < threads; i++)
+    {
+        t[i] = THREAD_create(InfoWorker, w + i);
+    }
+    InfoWorker(w);
+    for (i = 1; i < threads; i++)
+    {
+        if (t[i])
+        {
+            THREAD_join(t[i]);
+        }
+        else
+        {
+            InfoWorker(w + i);
+        }
+    }
+#if ACF
+    for (c = 0; c < nch; c++)
+    {
+        w[0].info.stat.ch[c].dm1 = w[threads - 1].info.stat.ch[c].dm1;
+    }
+#endif
+}
+
+
+/**
+*   Create high-resolution histograms for the total and each worker. If
+*   any allocation fails, histogram is disabled.
+*/
+static void InfoCreateHistograms(TFileInfo* info, stat_worker_t * w, unsigned int threads)
+{
+    unsigned int i;
+    int ok_q23 = 1;
+    int ok_float = 1;
+    info->has_hist_q23 = labs(info->bips) > 16 || info->pcm_type == E_PCM_IEEE_FLOAT;
+    info->has_hist_float = info->pcm_type == E_PCM_IEEE_FLOAT;
+    for (i = 0; i <= threads; i++)
+    {
+        TFileInfo * p = i < threads ? &w[i].info : info;
+        if (info->has_hist_q23)
+        {
+            p->hist_q23 = HIST_create(STAT_HIST_ENTRIES);
+            ok_q23 &= p->hist_q23 != NULL;
+        }
+        if (info->has_hist_float)
+        {
+            p->hist_float = HIST_create(STAT_HIST_ENTRIES);
+            ok_float &= p->hist_float != NULL;
+        }
+    }
+    for (i = 0; i <= threads; i++)
+    {
+        TFileInfo * p = i < threads ? &w[i].info : info;
+        if (!ok_q23)
+        {
+            HIST_free(p->hist_q23);
+            p->hist_q23 = NULL;
+        }
+        if (!ok_float)
+        {
+            HIST_free(p->hist_float);
+            p->hist_float = NULL;
+        }
+    }
 }
 
 
 static void FileStat (cmdline_options_t * opt)
 {
     int i;
-    size_t count;
+    uint64_t count;
     static TFileInfo  info;
     size_t nsamples;
+    size_t block;
     wav_file_t * file;
+    double * buf;
+    stat_worker_t * workers;
+    unsigned int threads = MIN(THREAD_cpu_count(), STAT_THREADS_MAX);
 
     memset(&info, 0, sizeof(info));
 
@@ -694,6 +1555,7 @@ static void FileStat (cmdline_options_t * opt)
     file = info.stat.file[0];
     info.stat.nch  = file->fmt.ch;
     info.bips = file->fmt.bips;
+    info.pcm_type = file->fmt.pcm_type;
 
     my_printf(_T("\nInformation for file: %s\n"), opt->file_name[0]);
     my_printf(_T("Format: %s, %d bits per sample, %d channels, %d Hz\n"),
@@ -702,17 +1564,54 @@ static void FileStat (cmdline_options_t * opt)
              WAV_samples_count(file),
              file->fmt.hz ? (double) WAV_samples_count(file) / file->fmt.hz : 0.);
 
-    while (0 != (nsamples = WAV_read_doubles(file, g_buf[0], BUF_SIZE_SAMPLES / file->fmt.ch )))
+    buf = malloc(STAT_BLOCK_SAMPLES * sizeof(double));
+    workers = calloc(threads, sizeof(stat_worker_t));
+    block = STAT_BLOCK_SAMPLES / file->fmt.ch;
+    if (!buf || !workers)
+    {
+        // Fall back to single thread with static buffer
+        free(buf);
+        free(workers);
+        buf = g_buf[0];
+        block = BUF_SIZE_SAMPLES / file->fmt.ch;
+        workers = calloc(1, sizeof(stat_worker_t));
+        threads = 1;
+        if (!workers)
+        {
+            my_printf(_T("ERROR: Not enough memory\n"));
+            WAV_close_read(file);
+            return;
+        }
+    }
+    for (i = 0; i < (int)threads; i++)
+    {
+        workers[i].info.stat.nch = info.stat.nch;
+    }
+    InfoCreateHistograms(&info, workers, threads);
+
+    while (0 != (nsamples = WAV_read_doubles(file, buf, block)))
     {
-        InfoUpdate(&info, g_buf[0], nsamples);
-        diff_stat_gather(&info.stat, g_buf[1], g_buf[0], g_buf[2], nsamples);
-        GAUGE_set_pos((double) (info.stat.samlpes_count * WAV_bytes_per_sample(file) + g_current_file_size) /
+        InfoUpdateParallel(workers, threads, buf, nsamples);
+        GAUGE_set_pos((double) ((info.stat.samlpes_count += nsamples) * WAV_bytes_per_sample(file) + g_current_file_size) /
                      g_total_file_size);
     }
+    info.stat.samlpes_count = 0;
+    for (i = 0; i < (int)threads; i++)
+    {
+        InfoMerge(&info, &workers[i].info);
+        HIST_free(workers[i].info.hist_q23);
+        HIST_free(workers[i].info.hist_float);
+    }
     diff_stat_sum_channels(&info.stat);
+    WAV_close_read(file);
+    if (buf != g_buf[0])
+    {
+        free(buf);
+    }
+    free(workers);
 
     my_printf(_T("Actual size       : %d samples read\n"), info.stat.samlpes_count);
-    count = info.stat.samlpes_count * info.stat.nch;
+    count = (uint64_t)info.stat.samlpes_count * info.stat.nch;
     if (count)
     {
         info.entropy256 = 0;
@@ -730,13 +1629,112 @@ static void FileStat (cmdline_options_t * opt)
                 info.entropy64k -= prob*log10(prob)*LOG2_10;
         }
     }
+    info.entropy_q23 = info.hist_q23 ? HIST_entropy(info.hist_q23) : -1;
+    info.shift_q23 = info.hist_q23 ? HIST_shift(info.hist_q23) : 0;
+    info.entropy_float = info.hist_float ? HIST_entropy(info.hist_float) : -1;
+    info.shift_float = info.hist_float ? HIST_shift(info.hist_float) : 0;
+    HIST_free(info.hist_q23);
+    HIST_free(info.hist_float);
+    info.hist_q23 = info.hist_float = NULL;
     OUTPUT_showStat(&info);
 }
 
 
-static int RunCompare (cmdline_options_t *opt)
+/**
+*   Build and print edit list for opened files
+*/
+static int RunEditList (file_stat_t * stat, cmdline_options_t *opt)
+{
+    int i;
+    size_t k;
+    int success = 0;
+    edit_list_t * edits = EDIT_build(stat->file[0], stat->file[1]);
+    GLITCH_free(stat->glitch);
+    RESAMPLE_free(stat->resampler);
+    free(stat->ch_shift_buf);
+    WAV_close_write(stat->diff);
+    if (!edits)
+    {
+        my_printf(_T("ERROR: not enough memory for edit list\n"));
+    }
+    else
+    {
+        OUTPUT_print_edits(stat->file, edits, opt);
+        for (k = 0; k < EDIT_count(edits); k++)
+        {
+            const edit_segment_t * e = EDIT_segment(edits, k);
+            g_tot.d_abs_max = MAX(g_tot.d_abs_max, e->d_abs_max);
+        }
+        if (EDIT_count(edits) != 1 || EDIT_segment(edits, 0)->type != E_EDIT_MATCH)
+        {
+            g_tot.files_edited++;
+        }
+        EDIT_free(edits);
+        success = 1;
+    }
+    for (i = 0; i < 2; i++)
+    {
+        WAV_close_read(stat->file[i]);
+    }
+    return success;
+}
+
+
+/**
+*   Output comparison result, update totals and close files
+*/
+static int ReportCompare (file_stat_t * stat, cmdline_options_t *opt)
 {
     int i, success = 0;
+    if (!stat->samlpes_count)
+    {
+        //TODO - format this
+        my_printf(_T("ERROR: no samples compared"));
+        success = 0;
+    }
+    else
+    {
+        diff_stat_update_totals(stat, &g_tot, opt->file_name[1]);
+        if (opt->tol_flag)
+        {
+            stat->tol_failed = diff_stat_tol_failed(stat, opt);
+            if (stat->tol_failed)
+            {
+                g_tot.files_out_of_tol++;
+            }
+        }
+        
+        // Output comparison result
+        OUTPUT_print_file_stat(stat->file, stat, opt);
+        if (stat->glitch)
+        {
+            OUTPUT_print_glitches(stat->file, stat, opt);
+            if (GLITCH_events_count(stat->glitch))
+            {
+                g_tot.files_with_glitches++;
+            }
+        }
+        if (stat->resync_count)
+        {
+            OUTPUT_print_resyncs(stat->file, stat, opt);
+            g_tot.files_resynced++;
+        }
+        success = 1;
+    }
+    GLITCH_free(stat->glitch);
+    RESAMPLE_free(stat->resampler);
+    free(stat->ch_shift_buf);
+    for (i = 0; i < 2; i++)
+    {
+        WAV_close_read(stat->file[i]);
+    }
+    return success;
+}
+
+
+static int RunCompare (cmdline_options_t *opt)
+{
+    int i;
     file_stat_t stat = {0,};
     OUTPUT_update_gauge_status(opt->file_name[0], &g_tot);
     // If only one argument specified, show file statistics
@@ -750,6 +1748,10 @@ static int RunCompare (cmdline_options_t *opt)
     {
         return 0;
     }
+    if (stat.from_cache)
+    {
+        return ReportCompare(&stat, opt);
+    }
     // Save files position
     for (i = 0; i < 2; i++)
     {
@@ -757,6 +1759,22 @@ static int RunCompare (cmdline_options_t *opt)
         stat.actualOffsetSamples[i] = (unsigned long)(WAV_get_sample_pos(file) - WAV_bytes_to_samples(file, opt->offset_bytes[i]));
         stat.remainingSamples[i] =  WAV_samples_count(file) - WAV_get_sample_pos(file);
     }
+
+    // Difference counter thresholds in LSB of the coarser file
+    stat.lsb_thr_count = opt->lsb_thr_count;
+    for (i = 0; i < (int)opt->lsb_thr_count; i++)
+    {
+        stat.lsb_thr[i] = ldexp(opt->lsb_thr[i], 1 - diff_stat_bips(stat.file));
+    }
+
+    if (opt->glitch_flag)
+    {
+        stat.glitch = GLITCH_alloc(stat.file[0]->fmt.ch, stat.file[0]->fmt.hz);
+        if (!stat.glitch)
+        {
+            my_printf(_T("WARNING: not enough memory for glitch detector\n"));
+        }
+    }
               
     if (opt->save_aligned_flag)
     {
@@ -772,37 +1790,41 @@ static int RunCompare (cmdline_options_t *opt)
             }
         }
     }
+    if (opt->edit_list_flag)
+    {
+        return RunEditList(&stat, opt);
+    }
+
     // Compare files
     if (!CompareFiles(&stat, opt))
     {
         // Comparison terminated, g_abort_flag set
+        GLITCH_free(stat.glitch);
+        RESAMPLE_free(stat.resampler);
+        free(stat.ch_shift_buf);
         return 0;
     }
     WAV_close_write(stat.diff);
     for (i = 0; i < 2; i++)
     {
-        stat.remainingSamples[i] -= stat.samlpes_count;
+        stat.remainingSamples[i] -= stat.samlpes_count + stat.resync_skipped[i];
     }
-    
-    if (!stat.samlpes_count)
+    if (stat.resampler)
     {
-        //TODO - format this
-        my_printf(_T("ERROR: no samples compared"));
-        success = 0;
+        // Resampled file: count samples, not consumed by resampler
+        stat.remainingSamples[1] = WAV_get_remaining_samples(stat.file[1]) + g_resample_fill;
     }
-    else
+    if (stat.ch_shift_buf)
     {
-        diff_stat_update_totals(&stat, &g_tot, opt->file_name[1]);
-        
-        // Output comparison result
-        OUTPUT_print_file_stat(stat.file, &stat, opt);
-        success = 1;
+        // Channels read ahead: count samples, not compared in the most delayed one
+        stat.remainingSamples[0] = WAV_get_remaining_samples(stat.file[0]) + stat.ch_shift_fill;
     }
-    for (i = 0; i < 2; i++)
+    
+    if (g_cache_key_valid && stat.samlpes_count && !CACHE_store(g_cache, &g_cache_key, &stat))
     {
-        WAV_close_read(stat.file[i]);
+        my_printf(_T("WARNING: can't write to cache file %s\n"), opt->cache_name);
     }
-    return success;
+    return ReportCompare(&stat, opt);
 }
 
 
@@ -887,6 +1909,15 @@ int _tmain (int argc, TCHAR *argv[])
     }
     g_total_file_size = dir.dir.files_size;
 
+    if (g_opt.cache_name)
+    {
+        g_cache = CACHE_open(g_opt.cache_name);
+        if (!g_cache)
+        {
+            my_printf(_T("WARNING: can't open cache file %s\n"), g_opt.cache_name);
+        }
+    }
+
     DIR3_for_each(&dir, process_file_callback, NULL);
     if (!dir.dir.is_single_file)
     {
@@ -895,13 +1926,15 @@ int _tmain (int argc, TCHAR *argv[])
         OUTPUT_update_gauge_status(status, &g_tot);
     }
 
-    // Set ERRORLEVEL = 1 if files not bit-exact or there was comparison errors
-    errorlevel = g_tot.d_abs_max != 0 || g_tot.files_compared != g_tot.files_count;
+    // Set ERRORLEVEL = 1 if files not bit-exact (with -tol: out of tolerance) or there was comparison errors
+    errorlevel = (g_opt.tol_flag ? g_tot.files_out_of_tol != 0 : g_tot.d_abs_max != 0) ||
+        g_tot.files_compared != g_tot.files_count || g_tot.files_edited;
     DIR3_close(&dir);
     OUTPUT_close(&g_opt, &g_tot);
 
 Cleanup:
-    ALIGN_close();
+    ALIGN_free(g_align);
+    CACHE_close(g_cache);
 #ifdef _MSC_VER
     assert(_CrtCheckMemory());
 #endif
@@ -5,6 +5,10 @@
 #define WAVDIFF_H
 
 #include "f_wav_io.h"
+#include "glitch.h"
+#include "editlist.h"
+#include "histogram.h"
+#include "dsp_resample.h"
 #include "../type_tchar.h"
 #include <wchar.h>
 
@@ -28,6 +32,9 @@ typedef unsigned long long uint64_t;
 #define MAX_CH 50
 #define ACF     1
 
+// Max number of LSB thresholds for difference counters
+#define MAX_LSB_THRESHOLDS 8
+
 /**
 *   Command-line options
 */
@@ -52,6 +59,20 @@ typedef struct
     unsigned int        offsetSamples[2];
     int                 align_range_samples;
     int                 save_aligned_flag;
+    int                 glitch_flag;
+    int                 drift_anchors;
+    int                 resync_flag;
+    int                 frac_flag;                  // Compensate sub-sample delay by resampling 2nd file
+    int                 align_ch_flag;              // Align each channel separately
+    int                 landmarks_flag;             // Coarse alignment by spectral fingerprints
+    int                 align_mem_bytes;            // Alignment buffers memory cap (0 - default)
+    int                 edit_list_flag;
+    double              lsb_thr[MAX_LSB_THRESHOLDS];   // Difference counter thresholds, LSB (ascending)
+    unsigned int        lsb_thr_count;
+    int                 tol_flag;                   // Check tolerance: max difference and count of differing samples
+    double              tol_lsb;                    // Max allowed difference, LSB
+    int64_t             tol_count;                  // Number of differing samples, which fails the check (0 - no limit)
+    TCHAR           *   cache_name;                 // Comparison results cache file (NULL - no cache)
     int                 no_warn_cant_open;
     int                 is_single_file;
 } cmdline_options_t;     
@@ -72,10 +93,29 @@ typedef struct
     double  d_mul_dm1;
     double  dm1;
 #endif
+    uint64_t lsb_over[MAX_LSB_THRESHOLDS];      // Number of samples with |diff| above each threshold
 } channel_stat_t;
 
 
+/**
+*   Re-alignment event
+*/
+typedef struct
+{
+    wavpos_t        pos;                        //!< Position in the 1st file, where re-alignment started
+    unsigned long   skipped[2];                 //!< Samples skipped from each file
+} resync_event_t;
+
+#define MAX_RESYNC_EVENTS 256
+
 #define MAX_FILES 3
+
+/**
+*   Layout version of file_stat_t: bump with any change of it, so that
+*   results, cached by earlier builds (statcache.c), are discarded
+*/
+#define FILE_STAT_VERSION 1
+
 /**
 *   file pair statistics
 */
@@ -94,10 +134,45 @@ typedef struct
         
     // Number of samples, skipped by alignment procedure
     unsigned long   actualOffsetSamples[2];
+
+    // Alignment match confidence (peak-to-sidelobe ratio), 0 if not aligned
+    double          align_psr;
         
     // Remaining samples in the files
     int64_t         remainingSamples[2];
 
+    // Dropouts and glitches detector (optional)
+    glitch_detector_t * glitch;
+
+    // Re-alignment events (only first MAX_RESYNC_EVENTS stored)
+    resync_event_t  resync[MAX_RESYNC_EVENTS];
+    unsigned int    resync_count;
+    unsigned long   resync_skipped[2];
+
+    // Difference counter thresholds, in sample units (LSB of the coarser file)
+    double          lsb_thr[MAX_LSB_THRESHOLDS];
+    unsigned int    lsb_thr_count;
+
+    // Tolerance check result (-tol option)
+    int             tol_failed;
+
+    // Clock drift of the 2nd file, ppm; 2nd file resampled if not zero
+    double          drift_ppm;
+    // Sub-sample delay of the 2nd file, samples; 2nd file resampled if not zero
+    double          delay;
+    resample_t      *resampler;
+
+    // Per-channel alignment: offsets found, and channel c of the 1st file
+    // read ahead by ch_shift[c] samples through ch_shift_buf, if not NULL
+    long            ch_offset[MAX_CH];
+    unsigned long   ch_shift[MAX_CH];
+    unsigned long   ch_shift_max;
+    double          *ch_shift_buf;
+    size_t          ch_shift_fill;
+
+    // Result taken from the cache (-cache option): files not compared
+    int             from_cache;
+
 } file_stat_t;
 
 /**
@@ -108,6 +183,10 @@ typedef struct
     unsigned int files_count;
     unsigned int files_compared;
     unsigned int files_differs;
+    unsigned int files_with_glitches;
+    unsigned int files_resynced;
+    unsigned int files_edited;
+    unsigned int files_out_of_tol;
     int64_t      total_samples_count;
     double       r_sumSqr;
     double       t_sumSqr;
@@ -129,12 +208,23 @@ typedef struct
     long    usedBits32;
     double  entropy256;
     double  entropy64k;
-    int     histogram256[256];
-    int     histogram64k[256*256];
+    uint64_t histogram256[256];
+    uint64_t histogram64k[256*256];
     int     bips;
+    enum pcm_data_type_e pcm_type;
+    hist_t * hist_q23;      // 24-bit quantizer codes (high-resolution files only)
+    hist_t * hist_float;    // 32-bit float values (floating-point files only)
+    int     has_hist_q23;
+    int     has_hist_float;
+    double  entropy_q23;    // -1 if not available
+    double  entropy_float;  // -1 if not available
+    unsigned int shift_q23;
+    unsigned int shift_float;
 } TFileInfo;
 
 
 double diff_stat_abs_max(channel_stat_t * s);
 
+int diff_stat_bips(wav_file_t * wf[2]);
+
 #endif //WAVDIFF_H